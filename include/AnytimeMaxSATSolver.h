@@ -0,0 +1,353 @@
+/**********************************************************************************[AnytimeMaxSATSolver.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef AnytimeMaxSATSolver_Interface_h
+#define AnytimeMaxSATSolver_Interface_h
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MaxSATInstance.h"
+#include "MaxSATLocalSearch.h"
+#include "MaxSATSolver.h"
+
+/** Class to compute a MaxSAT solution in the background
+ *
+ *  The search is run in a separate thread, while the caller can poll the best
+ *  model found so far, or wait for the search to finish. Each improving model
+ *  is handed to an optional callback, together with its cost and the lower
+ *  bound that is known at this point. The callback can request to stop
+ *  waiting for further models. The backend does not report lower bounds
+ *  during the search, hence the lower bound is 0 until the search proves a
+ *  model to be OPTIMAL, and equals its cost afterwards.
+ *
+ *  The time to wait for a result can be limited, and waiting can be
+ *  interrupted from any thread. In both cases, the best model found so far is
+ *  returned.
+ *
+ *  Improving models are reported for the given start assignment, in case it
+ *  satisfies all hard clauses, for the result of an optional local search,
+ *  and for the result of the backend.
+ *
+ *  Note: the backend cannot be interrupted, and there is no budget that
+ *  bounds its run time. The time limit and interrupt only stop waiting:
+ *  the background search continues until the backend finishes, but its
+ *  result is not reported anymore. The destructor blocks until then, which
+ *  can take as long as the whole search. To keep the latency of a caller
+ *  low, the object can be destroyed by another thread.
+ */
+class AnytimeMaxSATSolver {
+
+public:
+
+    /** Callback for improving models
+     *
+     *  The callback receives the model, its cost, and the best known lower
+     *  bound for the cost, which is 0 unless the model is optimal. If the callback returns false, the search is
+     *  stopped, and no further models are reported. Calls to the callback are
+     *  not executed in parallel, but might be executed by the thread that runs
+     *  the search.
+     */
+    typedef std::function<bool(const std::vector<int> &model, uint64_t cost, uint64_t lowerBound)> ModelCallback;
+
+private:
+
+    /** the formula to be solved */
+    MaxSATInstance formula;
+
+    /** callback for improving models, might be empty */
+    ModelCallback callback;
+
+    /** protects the members below */
+    mutable std::mutex lock;
+
+    /** serializes calls to the callback */
+    std::mutex callbackLock;
+
+    /** signals changes of the state below */
+    std::condition_variable changed;
+
+    /** thread that runs the backend */
+    std::thread searchThread;
+
+    /** status of the search, and best model with its cost */
+    MaxSATSolver::ReturnCode status;
+    std::vector<int> bestModel;
+    uint64_t bestCost;
+
+    /** whether the search has been started, finished, or stopped */
+    bool started;
+    bool finished;
+    bool stopped;
+
+    /** time budget in milliseconds, negative for no limit */
+    int64_t timeLimit;
+
+    /** point in time at which waiting for the search stops */
+    std::chrono::steady_clock::time_point deadline;
+
+    /** error code of the backend */
+    int errorCode;
+
+    /** number of local search flips before running the backend */
+    uint64_t localSearchFlips;
+
+    /** Explicitly disallow copy constructors */
+    AnytimeMaxSATSolver(const AnytimeMaxSATSolver& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    AnytimeMaxSATSolver& operator=(AnytimeMaxSATSolver const&) = delete;
+
+    /** Check whether a status cannot be improved anymore */
+    static bool isFinal(MaxSATSolver::ReturnCode status)
+    {
+        return status == MaxSATSolver::OPTIMAL || status == MaxSATSolver::UNSATISFIABLE;
+    }
+
+    /** Record a model, and report it to the callback if it improves the best
+     *  known model
+     *
+     *  @param modelStatus OPTIMAL, if the model is known to be optimal,
+     *                     SATISFIABLE otherwise
+     */
+    void offer(const std::vector<int> &model, uint64_t cost, MaxSATSolver::ReturnCode modelStatus)
+    {
+        uint64_t lowerBound = 0;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if(stopped || isFinal(status)) return;
+            const bool improves = bestModel.empty() || cost < bestCost;
+            if(!improves && modelStatus != MaxSATSolver::OPTIMAL) return;
+            if(improves) {
+                bestModel = model;
+                bestCost = cost;
+            }
+            status = modelStatus;
+            if(modelStatus == MaxSATSolver::OPTIMAL) lowerBound = bestCost;
+            changed.notify_all();
+        }
+
+        if(!callback) return;
+        std::unique_lock<std::mutex> callbackGuard(callbackLock);
+        if(!callback(model, cost, lowerBound)) interrupt();
+    }
+
+    /** Run the backend on the formula */
+    void search(std::vector<int> startAssignment, bool hasStartAssignment)
+    {
+        std::vector<int> model;
+        uint64_t cost = UINT64_MAX;
+        MaxSATSolver::ReturnCode ret = MaxSATSolver::ERROR;
+        int backendErrno = 0;
+
+        if(formula.empty()) {
+            formula.makeModel(model);
+            cost = 0;
+            ret = MaxSATSolver::OPTIMAL;
+        } else {
+            if(localSearchFlips > 0) {
+                MaxSATLocalSearch localSearch(formula);
+                if(localSearch.search(localSearchFlips, hasStartAssignment ? &startAssignment : 0)) {
+                    offer(localSearch.getModel(), localSearch.getCost(), MaxSATSolver::SATISFIABLE);
+                    startAssignment = localSearch.getModel();
+                    hasStartAssignment = true;
+                }
+            }
+            MaxSATSolver solver(formula.nVars(), formula.nClauses());
+            if(solver.getErrno() == 0 && formula.loadInto(solver))
+                ret = solver.compute_maxsat(model, cost, UINT64_MAX, hasStartAssignment ? &startAssignment : 0);
+            backendErrno = solver.getErrno();
+        }
+
+        if(ret == MaxSATSolver::OPTIMAL || ret == MaxSATSolver::SATISFIABLE) offer(model, cost, ret);
+
+        std::unique_lock<std::mutex> guard(lock);
+        if(ret == MaxSATSolver::UNSATISFIABLE && !stopped) {
+            status = ret;
+        } else if(ret == MaxSATSolver::ERROR || ret == MaxSATSolver::UNKNOWN) {
+            if(!stopped && !isFinal(status) && bestModel.empty()) status = ret;
+            errorCode = backendErrno;
+        }
+        finished = true;
+        changed.notify_all();
+    }
+
+public:
+
+    /** Prepare solving a copy of the given formula */
+    AnytimeMaxSATSolver(const MaxSATInstance &formula)
+    : formula(formula)
+    , status(MaxSATSolver::UNKNOWN)
+    , bestCost(UINT64_MAX)
+    , started(false)
+    , finished(false)
+    , stopped(false)
+    , timeLimit(-1)
+    , errorCode(0)
+    , localSearchFlips(0)
+    {}
+
+    /** Wait for the background search, and free all resources
+     *
+     *  Blocks until the backend finished, also after interrupt or an expired
+     *  time limit.
+     */
+    ~AnytimeMaxSATSolver()
+    {
+        if(searchThread.joinable()) searchThread.join();
+    }
+
+    /** Return error number code in case the search failed, see
+     *  MaxSATSolver::getErrno */
+    int getErrno() const
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        return errorCode;
+    }
+
+    /** Set the callback for improving models. Has to be called before start. */
+    void setCallback(const ModelCallback &modelCallback) { callback = modelCallback; }
+
+    /** Limit the wall clock time to wait for a result, starting with the call
+     *  to start. Has to be called before start.
+     *
+     *  @param milliseconds time budget, a negative value disables the limit
+     */
+    void setTimeLimit(int64_t milliseconds) { timeLimit = milliseconds; }
+
+    /** Run a local search with the given number of flips in the background
+     *  before the backend, see MaxSATLocalSearch. Its best model is reported
+     *  as improving model, and used as start assignment of the backend. The
+     *  value 0 disables the local search, which is the default. Has to be
+     *  called before start.
+     */
+    void setLocalSearch(uint64_t flips) { localSearchFlips = flips; }
+
+    /** Start the search in the background
+     *
+     *  In case the start assignment satisfies all hard clauses, it is
+     *  reported as first model before this method returns.
+     *
+     *  Possible error codes:
+     *   -EINVAL ... the search has been started already
+     *   -ENOMEM ... the background search could not be started
+     *
+     *  @param startAssignment see MaxSATSolver::compute_maxsat
+     *  @return true, if the search has been started
+     */
+    bool start(const std::vector<int> *startAssignment = 0)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if(started) {
+                errorCode = -EINVAL;
+                return false;
+            }
+            started = true;
+            if(timeLimit >= 0)
+                deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeLimit);
+        }
+
+        uint64_t cost = 0;
+        if(startAssignment && formula.computeCost(*startAssignment, cost)) {
+            std::vector<int> model;
+            formula.makeModel(model, startAssignment);
+            offer(model, cost, MaxSATSolver::SATISFIABLE);
+        }
+
+        try {
+            searchThread = std::thread(&AnytimeMaxSATSolver::search, this,
+                                       startAssignment ? *startAssignment : std::vector<int>(),
+                                       startAssignment != 0);
+        } catch (std::exception &e) {
+            std::unique_lock<std::mutex> guard(lock);
+            errorCode = -ENOMEM;
+            finished = true;
+            if(bestModel.empty()) status = MaxSATSolver::ERROR;
+            return false;
+        }
+        return true;
+    }
+
+    /** Stop waiting for the search, and do not report further models
+     *
+     *  This method can be called from any thread, including the callback.
+     *  Waiting calls return promptly with the best model found so far. The
+     *  backend is not stopped, and keeps its thread and memory until it
+     *  finishes, such that the destructor still blocks until then.
+     */
+    void interrupt()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        stopped = true;
+        changed.notify_all();
+    }
+
+    /** Check whether the search finished or has been stopped */
+    bool done() const
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        return finished || stopped;
+    }
+
+    /** Copy the best model found so far
+     *
+     *  @return UNKNOWN, if no model has been found yet
+     *          SATISFIABLE, if a model has been found, that is not known to be
+     *                       optimal
+     *          OPTIMAL, UNSATISFIABLE, or ERROR, if the search finished with
+     *                   this result
+     */
+    MaxSATSolver::ReturnCode poll(std::vector<int> &model, uint64_t &cost) const
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        model = bestModel;
+        cost = bestCost;
+        return status;
+    }
+
+    /** Wait until the search finished, has been stopped, or the time limit
+     *  has been reached, and return the best known result, see poll
+     */
+    MaxSATSolver::ReturnCode wait(std::vector<int> &model, uint64_t &cost)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while(started && !finished && !stopped) {
+                if(timeLimit < 0) {
+                    changed.wait(guard);
+                } else if(changed.wait_until(guard, deadline) == std::cv_status::timeout) {
+                    stopped = true;
+                }
+            }
+        }
+        return poll(model, cost);
+    }
+
+    /** Run the search, and wait for its result
+     *
+     *  The semantics of the parameters and the return value are the same as
+     *  for MaxSATSolver::compute_maxsat. In case the callback stopped the
+     *  search, the search has been interrupted, or the time limit has been
+     *  reached, the best model found so far is returned.
+     */
+    MaxSATSolver::ReturnCode compute_maxsat(std::vector<int> &model,
+                                            uint64_t &cost,
+                                            const std::vector<int> *startAssignment = 0)
+    {
+        if(!start(startAssignment) && getErrno() == -EINVAL) return MaxSATSolver::ERROR;
+        return wait(model, cost);
+    }
+};
+
+#endif
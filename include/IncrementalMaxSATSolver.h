@@ -0,0 +1,978 @@
+/**********************************************************************************[IncrementalMaxSATSolver.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef IncrementalMaxSATSolver_Interface_h
+#define IncrementalMaxSATSolver_Interface_h
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "MaxSATInstance.h"
+#include "MaxSATLocalSearch.h"
+#include "MaxSATPreprocessor.h"
+#include "MaxSATSolutionCache.h"
+#include "MaxSATSolver.h"
+
+/** Class to solve a sequence of growing MaxSAT formulas
+ *
+ *  Different to MaxSATSolver, clauses and at-most-k constraints can still be
+ *  added after a compute method has been called. The formula is recorded in
+ *  a MaxSATInstance, and each call to compute_maxsat loads the formula into a
+ *  fresh MaxSATSolver backend.
+ *
+ *  Results of the previous call are reused: as constraints can only be added,
+ *  the previous optimum is a lower bound for the cost of the extended formula.
+ *  Hence, in case the previous optimal model also satisfies all added
+ *  constraints without falsifying added soft clauses, it is returned without
+ *  calling the backend. Otherwise, the previous model is used as start
+ *  assignment for the next search.
+ */
+class IncrementalMaxSATSolver {
+
+public:
+
+    /** Methods to reduce the conflict of assumptions, see
+     *  setConflictMinimization */
+    enum ConflictMinimization {
+        CONFLICT_NONE = 0,
+        CONFLICT_PROPAGATION = 1,
+        CONFLICT_DESTRUCTIVE = 2,
+    };
+
+    /** Known bounds on the optimal cost at some point in time */
+    struct Bound {
+        double seconds;
+        uint64_t lowerBound;
+        uint64_t upperBound;
+    };
+
+    /** Counters and timers of the calls since the last resetStatistics
+     *
+     *  Counters are always collected. Timers, the bound timeline, the effect
+     *  of preprocessing, and the memory estimates are only collected after
+     *  enabling them with setStatistics.
+     */
+    struct Statistics {
+        uint64_t calls;
+        uint64_t reusedOptima;
+        uint64_t backendCalls;
+        uint64_t localSearchRuns;
+        uint64_t localSearchFlips;
+        uint64_t strata;
+        uint64_t hardenedClauses;
+        uint64_t conflictChecks;
+
+        /** time per phase, in seconds */
+        double preprocessingTime;
+        double localSearchTime;
+        double backendTime;
+        double conflictTime;
+
+        /** bounds reported by stratification levels and calls, with the
+         *  time since the last resetStatistics */
+        std::vector<Bound> bounds;
+
+        /** simplifications of all preprocessing runs */
+        MaxSATPreprocessor::Statistics preprocessing;
+
+        /** memory of the recorded formula, and the highest backend estimate */
+        size_t formulaBytes;
+        size_t backendBytes;
+
+        Statistics()
+        : calls(0), reusedOptima(0), backendCalls(0), localSearchRuns(0), localSearchFlips(0), strata(0)
+        , hardenedClauses(0), conflictChecks(0), preprocessingTime(0), localSearchTime(0), backendTime(0)
+        , conflictTime(0), formulaBytes(0), backendBytes(0) {}
+    };
+
+private:
+
+    /** Add the wall clock time of its lifetime to a timer, if not 0 */
+    class PhaseTimer {
+        double *timer;
+        std::chrono::steady_clock::time_point start;
+    public:
+        PhaseTimer(double *phaseTimer) : timer(phaseTimer)
+        {
+            if(timer) start = std::chrono::steady_clock::now();
+        }
+        ~PhaseTimer()
+        {
+            if(timer) *timer += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    /** all constraints that have been added so far */
+    MaxSATInstance formula;
+
+    /** error code of the last failed call, see MaxSATSolver::getErrno */
+    int errorCode;
+
+    /** status of the last call to compute_maxsat */
+    MaxSATSolver::ReturnCode lastStatus;
+
+    /** model reported by the last call to compute_maxsat */
+    std::vector<int> lastModel;
+
+    /** cost of lastModel */
+    uint64_t lastCost;
+
+    /** number of clauses of the formula during the last call */
+    size_t solvedClauses;
+
+    /** number of at-most-k constraints of the formula during the last call */
+    size_t solvedAtMostK;
+
+    /** whether the formula is simplified before calling the backend */
+    bool preprocessing;
+
+    /** number of modifications of the recorded formula */
+    uint64_t formulaRevision;
+
+    /** last preprocessing run on the recorded formula, and the revision,
+     *  soft clause mode and assumptions it was run for */
+    MaxSATPreprocessor formulaPreprocessor;
+    uint64_t preprocessedRevision;
+    bool preprocessedSoftClauses;
+    std::vector<int> preprocessedAssumptions;
+    bool preprocessedResult;
+
+    /** whether soft clauses are solved in levels of decreasing weight */
+    bool stratification;
+
+    /** number of local search flips before calling the backend, 0 disables */
+    uint64_t localSearchFlips;
+
+    /** whether a valid start assignment bounds the cost of the search */
+    bool warmStart;
+
+    /** method to reduce conflicts, and budget of backend calls per conflict */
+    ConflictMinimization conflictMinimization;
+    int64_t conflictBudget;
+
+    /** maximal number of bytes for the formula and a backend, 0 for no limit */
+    size_t memoryLimit;
+
+    /** cache of optimal models, shared with other solvers, or 0 */
+    MaxSATSolutionCache *solutionCache;
+
+    /** statistics, and whether the detailed statistics are collected */
+    Statistics statistics;
+    bool detailedStatistics;
+    std::chrono::steady_clock::time_point statisticsStart;
+
+    /** Explicitly disallow copy constructors */
+    IncrementalMaxSATSolver(const IncrementalMaxSATSolver& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    IncrementalMaxSATSolver& operator=(IncrementalMaxSATSolver const&) = delete;
+
+    /** Timer of a phase, if detailed statistics are collected */
+    double *phaseTimer(double &timer) { return detailedStatistics ? &timer : 0; }
+
+    /** Append known bounds to the timeline of the detailed statistics */
+    void recordBound(uint64_t lowerBound, uint64_t upperBound)
+    {
+        if(!detailedStatistics) return;
+        const Bound bound = {std::chrono::duration<double>(std::chrono::steady_clock::now() - statisticsStart).count(),
+                             lowerBound, upperBound};
+        statistics.bounds.push_back(bound);
+    }
+
+    /** Store the result of a call, and forward it to the caller */
+    MaxSATSolver::ReturnCode report(MaxSATSolver::ReturnCode status,
+                                    std::vector<int> &model, uint64_t &cost)
+    {
+        lastStatus = status;
+        if(!model.empty()) recordBound(status == MaxSATSolver::OPTIMAL ? cost : 0, cost);
+        solvedClauses = formula.nClauses();
+        solvedAtMostK = formula.nAtMostK();
+        if(status == MaxSATSolver::UNSATISFIABLE || status == MaxSATSolver::ERROR) {
+            lastModel.clear();
+        } else if(!model.empty()) {
+            lastModel = model;
+            lastCost = cost;
+        }
+        return status;
+    }
+
+    /** Check whether the model of the previous call is still optimal
+     *
+     *  As constraints are only added, the previous optimum is a lower bound
+     *  for the current formula. Hence, the previous optimal model is still
+     *  optimal, if it satisfies all added constraints, and does not falsify
+     *  added soft clauses. In this case, the model is copied to the caller.
+     */
+    bool reusePreviousOptimum(std::vector<int> &model, uint64_t &cost, uint64_t maxCost,
+                              const std::vector<int> *assumptions)
+    {
+        if(lastStatus != MaxSATSolver::OPTIMAL || lastModel.empty() || lastCost >= maxCost) return false;
+        for(size_t i = 0; assumptions && i < assumptions->size(); ++i)
+            if(!MaxSATInstance::isTrue(lastModel, (*assumptions)[i])) return false;
+
+        uint64_t addedCost = 0;
+        if(!formula.computeCost(lastModel, addedCost, solvedClauses, solvedAtMostK) || addedCost != 0)
+            return false;
+        statistics.reusedOptima++;
+        model = lastModel;
+        cost = lastCost;
+        return true;
+    }
+
+    /** Use the given assignment as best known model, if it satisfies the hard
+     *  part of the problem and the assumptions, and its cost is below maxCost
+     *  and the cost of the best known model */
+    static void acceptHint(const MaxSATInstance &problem, const std::vector<int> &assignment,
+                           const std::vector<int> *assumptions, uint64_t maxCost,
+                           std::vector<int> &hint, uint64_t &hintCost)
+    {
+        uint64_t cost = 0;
+        if(!problem.computeCost(assignment, cost) || cost >= maxCost || cost >= hintCost) return;
+        for(size_t i = 0; assumptions && i < assumptions->size(); ++i)
+            if(!MaxSATInstance::isTrue(assignment, (*assumptions)[i])) return;
+        problem.makeModel(hint, &assignment);
+        hintCost = cost;
+    }
+
+    /** Estimate the memory a backend needs for the given formula
+     *
+     *  Each variable and each clause of the backend comes with a constant
+     *  overhead, each literal is stored once, and two literals of each clause
+     *  are watched. At-most-k constraints are assumed to be encoded with a
+     *  few binary clauses per literal. Learnt clauses are expected to need as
+     *  much memory as the formula itself.
+     */
+    static size_t backendMemoryEstimate(const MaxSATInstance &problem, size_t assumptions)
+    {
+        const size_t perVariable = 96, perClause = 48, perLiteral = 4, perAtMostKLiteral = 3 * (perClause + 2 * perLiteral);
+        size_t bytes = (problem.nVars() + 1) * perVariable + (problem.nClauses() + assumptions) * perClause;
+        for(size_t i = 0; i < problem.nClauses(); ++i) bytes += problem.clauseSize(i) * perLiteral;
+        for(size_t i = 0; i < problem.nAtMostK(); ++i) bytes += problem.atMostKSize(i) * perAtMostKLiteral;
+        return 2 * bytes;
+    }
+
+    /** Check whether the formula copies of this call and a backend for the
+     *  given problem fit into the memory limit */
+    bool fitsMemoryLimit(const MaxSATInstance &input, const MaxSATInstance &problem, size_t assumptions) const
+    {
+        if(memoryLimit == 0) return true;
+        size_t bytes = formula.memoryUsage() + backendMemoryEstimate(problem, assumptions);
+        if(&input != &formula) bytes += input.memoryUsage();
+        if(&problem != &input) bytes += problem.memoryUsage();
+        return bytes <= memoryLimit;
+    }
+
+    /** Load the given formula and assumptions into a fresh backend, and
+     *  call compute_maxsat */
+    MaxSATSolver::ReturnCode solveBackend(const MaxSATInstance &problem, std::vector<int> &model, uint64_t &cost,
+                                          const std::vector<int> *assumptions, bool withSoftClauses,
+                                          uint64_t maxCost, const std::vector<int> *startAssignment,
+                                          int64_t maxMinimizeSteps)
+    {
+        statistics.backendCalls++;
+        PhaseTimer timer(phaseTimer(statistics.backendTime));
+        if(detailedStatistics) {
+            const size_t bytes = backendMemoryEstimate(problem, assumptions ? assumptions->size() : 0);
+            statistics.backendBytes = std::max(statistics.backendBytes, bytes);
+        }
+        MaxSATSolver solver(problem.nVars(), problem.nClauses() + (assumptions ? assumptions->size() : 0));
+        if(solver.getErrno() != 0 || !problem.loadInto(solver, withSoftClauses)) {
+            errorCode = solver.getErrno();
+            return MaxSATSolver::ERROR;
+        }
+        std::vector<int> unit(1, 0);
+        for(size_t i = 0; assumptions && i < assumptions->size(); ++i) {
+            unit[0] = (*assumptions)[i];
+            if(!solver.addClause(unit)) {
+                errorCode = solver.getErrno();
+                return MaxSATSolver::ERROR;
+            }
+        }
+
+        MaxSATSolver::ReturnCode ret = solver.compute_maxsat(model, cost, maxCost, startAssignment, maxMinimizeSteps);
+        errorCode = solver.getErrno();
+        // without a model below maxCost, the backend reports its last model with cost UINT64_MAX
+        if((ret == MaxSATSolver::OPTIMAL || ret == MaxSATSolver::SATISFIABLE) && (cost == UINT64_MAX || cost >= maxCost)) {
+            model.clear();
+            cost = UINT64_MAX;
+            ret = MaxSATSolver::UNKNOWN;
+        }
+        return ret;
+    }
+
+    /** Run the given preprocessor on a formula, and collect its statistics */
+    bool runPreprocessor(MaxSATPreprocessor &preprocessor, const MaxSATInstance &input, bool withSoftClauses,
+                         const std::vector<int> *assumptions)
+    {
+        bool simplified = false;
+        {
+            PhaseTimer timer(phaseTimer(statistics.preprocessingTime));
+            simplified = preprocessor.simplify(input, withSoftClauses, assumptions);
+        }
+        if(detailedStatistics) addPreprocessingStatistics(preprocessor.getStatistics());
+        return simplified;
+    }
+
+    /** Preprocess the recorded formula into formulaPreprocessor, unless the
+     *  last run used the same revision, soft clause mode and assumptions
+     *
+     *  @return false, if the hard part of the formula is unsatisfiable
+     */
+    bool preprocessFormula(bool withSoftClauses, const std::vector<int> *assumptions)
+    {
+        const std::vector<int> noAssumptions;
+        const std::vector<int> &units = assumptions ? *assumptions : noAssumptions;
+        if(preprocessedRevision == formulaRevision && preprocessedSoftClauses == withSoftClauses &&
+           preprocessedAssumptions == units)
+            return preprocessedResult;
+
+        preprocessedRevision = UINT64_MAX;
+        preprocessedResult = runPreprocessor(formulaPreprocessor, formula, withSoftClauses, assumptions);
+        preprocessedAssumptions = units;
+        preprocessedSoftClauses = withSoftClauses;
+        preprocessedRevision = formulaRevision;
+        return preprocessedResult;
+    }
+
+    /** Load the given formula into a fresh backend, and run a single
+     *  computation
+     *
+     *  @param assumptions literals to be added as unit hard clauses, if not 0
+     *  @param withSoftClauses whether soft clauses are part of the problem
+     */
+    MaxSATSolver::ReturnCode solveOnce(const MaxSATInstance &input, std::vector<int> &model, uint64_t &cost,
+                                       const std::vector<int> *assumptions, bool withSoftClauses,
+                                       uint64_t maxCost, const std::vector<int> *startAssignment,
+                                       int64_t maxMinimizeSteps)
+    {
+        model.clear();
+        cost = UINT64_MAX;
+
+        // the simplified formula fixes the assumptions already
+        const MaxSATInstance *problem = &input;
+        // the recorded formula is preprocessed once per revision, strata per call
+        MaxSATPreprocessor stratumPreprocessor;
+        const MaxSATPreprocessor *preprocessor = &formulaPreprocessor;
+        if(preprocessing) {
+            bool simplified = false;
+            if(&input == &formula) {
+                simplified = preprocessFormula(withSoftClauses, assumptions);
+            } else {
+                preprocessor = &stratumPreprocessor;
+                simplified = runPreprocessor(stratumPreprocessor, input, withSoftClauses, assumptions);
+            }
+            if(!simplified) return MaxSATSolver::UNSATISFIABLE;
+            if(maxCost == UINT64_MAX || maxCost > preprocessor->getFixedCost()) {
+                problem = &preprocessor->getFormula();
+                assumptions = 0;
+                if(maxCost != UINT64_MAX) maxCost -= preprocessor->getFixedCost();
+            }
+        }
+
+        MaxSATSolver::ReturnCode ret = MaxSATSolver::OPTIMAL;
+        // the backend does not accept empty formulas
+        const bool hasConstraints = problem->nAtMostK() > 0 || (assumptions && !assumptions->empty()) ||
+                                    (withSoftClauses ? problem->nClauses() > 0 : hasHardClauses(*problem));
+        if(!hasConstraints) {
+            problem->makeModel(model);
+            cost = 0;
+        } else {
+            // the best known model is the start assignment, and its cost the upper bound
+            std::vector<int> hint;
+            uint64_t hintCost = UINT64_MAX;
+            if(warmStart && withSoftClauses && startAssignment)
+                acceptHint(*problem, *startAssignment, assumptions, maxCost, hint, hintCost);
+            if(localSearchFlips > 0 && withSoftClauses) {
+                PhaseTimer timer(phaseTimer(statistics.localSearchTime));
+                MaxSATLocalSearch localSearch(*problem);
+                const bool found = localSearch.search(localSearchFlips, startAssignment, assumptions);
+                statistics.localSearchRuns++;
+                statistics.localSearchFlips += localSearch.getFlips();
+                if(found) acceptHint(*problem, localSearch.getModel(), assumptions, maxCost, hint, hintCost);
+            }
+            if(!hint.empty()) {
+                startAssignment = &hint;
+                maxCost = hintCost + 1;
+            }
+            const size_t nAssumptions = assumptions ? assumptions->size() : 0;
+            if(hintCost == 0) {
+                model.swap(hint);
+                cost = 0;
+            } else if(!fitsMemoryLimit(input, *problem, nAssumptions)) {
+                // without a backend, any valid start assignment is better than no model
+                if(hint.empty() && withSoftClauses && startAssignment)
+                    acceptHint(*problem, *startAssignment, assumptions, maxCost, hint, hintCost);
+                errorCode = -ENOMEM;
+                ret = hint.empty() ? MaxSATSolver::UNKNOWN : MaxSATSolver::SATISFIABLE;
+                model.swap(hint);
+                cost = hintCost;
+            } else {
+                ret = solveBackend(*problem, model, cost, assumptions, withSoftClauses, maxCost, startAssignment, maxMinimizeSteps);
+                if(ret == MaxSATSolver::ERROR && errorCode == -ENOMEM && !hint.empty()) ret = MaxSATSolver::SATISFIABLE;
+                if(ret == MaxSATSolver::ERROR || ret == MaxSATSolver::UNSATISFIABLE) return ret;
+                if(model.empty() && !hint.empty()) {
+                    model.swap(hint);
+                    cost = hintCost;
+                }
+            }
+        }
+
+        // the cost of the simplified formula does not contain fixed cost
+        if(problem != &input && !model.empty()) {
+            preprocessor->extendModel(model);
+            input.computeCost(model, cost);
+        }
+        return ret;
+    }
+
+    /** Add the simplifications of a preprocessing run to the statistics */
+    void addPreprocessingStatistics(const MaxSATPreprocessor::Statistics &run)
+    {
+        MaxSATPreprocessor::Statistics &total = statistics.preprocessing;
+        total.fixedVariables += run.fixedVariables;
+        total.failedLiterals += run.failedLiterals;
+        total.removedClauses += run.removedClauses;
+        total.removedLiterals += run.removedLiterals;
+        total.mergedSoftClauses += run.mergedSoftClauses;
+    }
+
+    /** Select the next weight threshold for stratification
+     *
+     *  Starting after the given threshold, weights are added in decreasing
+     *  order, until the added soft clauses have sufficiently few distinct
+     *  weights, i.e. the ratio of clauses per distinct weight exceeds the
+     *  diversity limit. This way, levels with many different weights are
+     *  merged, as solving them one by one does not pay off.
+     *
+     *  @param weights distinct weights of the soft clauses, in decreasing order
+     *  @param counts number of soft clauses per weight
+     *  @return position of the next threshold in weights
+     */
+    static size_t nextStratum(const std::vector<uint64_t> &weights, const std::vector<size_t> &counts,
+                              size_t current)
+    {
+        const double diversityLimit = 1.25;
+        size_t clauses = 0, distinct = 0, next = current;
+        while(next + 1 < weights.size()) {
+            ++next;
+            clauses += counts[next];
+            ++distinct;
+            if((double)clauses / distinct > diversityLimit) break;
+        }
+        return next;
+    }
+
+    /** Solve the formula in levels of decreasing soft clause weights
+     *
+     *  Each level contains all hard clauses, and the soft clauses with at
+     *  least the weight of the level. The optimum of a level is a lower bound
+     *  for the cost of the formula, and its model an upper bound. Soft
+     *  clauses of lower levels, whose weight exceeds the gap between both
+     *  bounds, are satisfied by every optimal model, and are hardened. The
+     *  search stops as soon as both bounds meet.
+     */
+    MaxSATSolver::ReturnCode solveStratified(std::vector<int> &model, uint64_t &cost,
+                                             const std::vector<int> *assumptions, uint64_t maxCost,
+                                             const std::vector<int> *startAssignment,
+                                             int64_t maxMinimizeSteps)
+    {
+        std::vector<uint64_t> weights;
+        for(size_t i = 0; i < formula.nClauses(); ++i)
+            if(formula.weight(i) != 0) weights.push_back(formula.weight(i));
+        std::sort(weights.begin(), weights.end(), std::greater<uint64_t>());
+        std::vector<size_t> counts;
+        for(size_t i = 0; i < weights.size(); ++i) {
+            if(i > 0 && weights[i] == weights[i - 1]) counts.back()++;
+            else counts.push_back(1);
+        }
+        weights.erase(std::unique(weights.begin(), weights.end()), weights.end());
+        if(weights.size() < 2)
+            return solveOnce(formula, model, cost, assumptions, true, maxCost, startAssignment, maxMinimizeSteps);
+
+        std::vector<bool> hardened(formula.nClauses(), false);
+        std::vector<int> levelModel, bestModel;
+        uint64_t bestCost = UINT64_MAX;
+        const std::vector<int> *start = startAssignment;
+        size_t level = 0;
+        for(; level + 1 < weights.size(); level = nextStratum(weights, counts, level)) {
+            const uint64_t threshold = weights[level];
+            MaxSATInstance stratum(formula.nVars(), formula.nClauses());
+            for(size_t i = 0; i < formula.nClauses(); ++i) {
+                const uint64_t weight = hardened[i] ? 0 : formula.weight(i);
+                if(weight != 0 && weight < threshold) continue;
+                if(!stratum.addClause(formula.clause(i), formula.clauseSize(i), weight)) {
+                    errorCode = stratum.getErrno();
+                    return MaxSATSolver::ERROR;
+                }
+            }
+            for(size_t i = 0; i < formula.nAtMostK(); ++i) {
+                const std::vector<int> literals(formula.atMostK(i), formula.atMostK(i) + formula.atMostKSize(i));
+                if(!stratum.addAtMostK(literals, formula.atMostKBound(i), MaxSATInstance::LIBRARY)) {
+                    errorCode = stratum.getErrno();
+                    return MaxSATSolver::ERROR;
+                }
+            }
+
+            uint64_t lowerBound = UINT64_MAX;
+            statistics.strata++;
+            MaxSATSolver::ReturnCode ret = solveOnce(stratum, levelModel, lowerBound, assumptions, true,
+                                                     UINT64_MAX, start, maxMinimizeSteps);
+            if(ret == MaxSATSolver::UNSATISFIABLE || ret == MaxSATSolver::ERROR) return ret;
+
+            uint64_t upperBound = UINT64_MAX;
+            if(!levelModel.empty()) formula.computeCost(levelModel, upperBound);
+            if(upperBound < bestCost) {
+                bestCost = upperBound;
+                bestModel = levelModel;
+                start = &bestModel;
+            }
+            // without a proven lower bound, the remaining levels are solved at once
+            if(ret != MaxSATSolver::OPTIMAL || levelModel.empty()) break;
+            recordBound(lowerBound, bestCost);
+            if(bestCost == lowerBound && bestCost < maxCost) {
+                model = bestModel;
+                cost = bestCost;
+                return MaxSATSolver::OPTIMAL;
+            }
+
+            // falsifying a clause of a lower level adds its weight to the lower bound
+            for(size_t i = 0; i < formula.nClauses(); ++i) {
+                const uint64_t weight = formula.weight(i);
+                if(weight == 0 || weight >= threshold || weight <= bestCost - lowerBound || hardened[i]) continue;
+                hardened[i] = true;
+                statistics.hardenedClauses++;
+            }
+        }
+
+        MaxSATInstance remaining(formula.nVars(), formula.nClauses());
+        for(size_t i = 0; i < formula.nClauses(); ++i) {
+            if(!remaining.addClause(formula.clause(i), formula.clauseSize(i), hardened[i] ? 0 : formula.weight(i))) {
+                errorCode = remaining.getErrno();
+                return MaxSATSolver::ERROR;
+            }
+        }
+        for(size_t i = 0; i < formula.nAtMostK(); ++i) {
+            const std::vector<int> literals(formula.atMostK(i), formula.atMostK(i) + formula.atMostKSize(i));
+            if(!remaining.addAtMostK(literals, formula.atMostKBound(i), MaxSATInstance::LIBRARY)) {
+                errorCode = remaining.getErrno();
+                return MaxSATSolver::ERROR;
+            }
+        }
+        MaxSATSolver::ReturnCode ret = solveOnce(remaining, model, cost, assumptions, true, maxCost, start, maxMinimizeSteps);
+        // e.g. the memory limit prevents the last call, but a level found a model
+        if(model.empty() && ret == MaxSATSolver::UNKNOWN && !bestModel.empty() && bestCost < maxCost) {
+            model.swap(bestModel);
+            cost = bestCost;
+            ret = MaxSATSolver::SATISFIABLE;
+        }
+        return ret;
+    }
+
+    /** Run a computation on the formula, stratified if enabled
+     *
+     *  @param assumptions literals to be added as unit hard clauses, if not 0
+     *  @param withSoftClauses whether soft clauses are part of the problem
+     */
+    MaxSATSolver::ReturnCode solve(std::vector<int> &model, uint64_t &cost,
+                                   const std::vector<int> *assumptions, bool withSoftClauses,
+                                   uint64_t maxCost, const std::vector<int> *startAssignment,
+                                   int64_t maxMinimizeSteps)
+    {
+        if(stratification && withSoftClauses)
+            return solveStratified(model, cost, assumptions, maxCost, startAssignment, maxMinimizeSteps);
+        return solveOnce(formula, model, cost, assumptions, withSoftClauses, maxCost, startAssignment, maxMinimizeSteps);
+    }
+
+    /** Check whether the given formula contains at least one hard clause */
+    static bool hasHardClauses(const MaxSATInstance &problem)
+    {
+        for(size_t i = 0; i < problem.nClauses(); ++i)
+            if(problem.weight(i) == 0) return true;
+        return false;
+    }
+
+    /** Check whether the hard part of the formula is still unsatisfiable
+     *  under the given assumptions
+     *
+     *  Unit propagation is tried first, or the full preprocessing, if it is
+     *  enabled, as the backend call reuses its result. The backend is only
+     *  called, if this cannot show unsatisfiability, and the budget of
+     *  backend calls is not exhausted yet. Without a decision, false is
+     *  returned.
+     */
+    bool stillUnsatisfiable(const std::vector<int> &candidate, int64_t &budget, bool &failed)
+    {
+        if(preprocessing) {
+            if(!preprocessFormula(false, &candidate)) return true;
+        } else {
+            MaxSATPreprocessor propagation;
+            propagation.setSubsumptionLimit(0);
+            propagation.setProbingLimit(0);
+            if(!propagation.simplify(formula, false, &candidate)) return true;
+        }
+        if(conflictMinimization != CONFLICT_DESTRUCTIVE || budget == 0) return false;
+        if(budget > 0) --budget;
+        statistics.conflictChecks++;
+
+        std::vector<int> model;
+        uint64_t cost = 0;
+        MaxSATSolver::ReturnCode ret = solve(model, cost, &candidate, false, UINT64_MAX, 0, -1);
+        failed = ret == MaxSATSolver::ERROR;
+        return ret == MaxSATSolver::UNSATISFIABLE;
+    }
+
+    /** Reduce a set of assumptions that is unsatisfiable with the hard part
+     *  of the formula, see setConflictMinimization
+     *
+     *  Assumptions are dropped in chunks, starting with half of the set, and
+     *  halving the chunk size after each round. A chunk is dropped, if the
+     *  hard part of the formula is still unsatisfiable without it. The last
+     *  round tests single assumptions, such that with an unlimited budget no
+     *  assumption can be dropped from the result anymore.
+     */
+    MaxSATSolver::ReturnCode minimizeConflict(const std::vector<int> &assumptions,
+                                              std::vector<int> &conflict)
+    {
+        conflict = assumptions;
+        std::sort(conflict.begin(), conflict.end());
+        conflict.erase(std::unique(conflict.begin(), conflict.end()), conflict.end());
+        if(conflictMinimization == CONFLICT_NONE) return MaxSATSolver::UNSATISFIABLE;
+
+        PhaseTimer timer(phaseTimer(statistics.conflictTime));
+        int64_t budget = conflictBudget;
+        bool failed = false;
+        std::vector<int> candidate;
+        for(size_t chunk = std::max<size_t>(conflict.size() / 2, 1); chunk > 0; chunk /= 2) {
+            for(size_t i = 0; i < conflict.size(); ) {
+                const size_t end = std::min(i + chunk, conflict.size());
+                candidate.assign(conflict.begin(), conflict.begin() + i);
+                candidate.insert(candidate.end(), conflict.begin() + end, conflict.end());
+                if(stillUnsatisfiable(candidate, budget, failed)) conflict.swap(candidate);
+                else i = end;
+                if(failed) return MaxSATSolver::ERROR;
+            }
+        }
+        return MaxSATSolver::UNSATISFIABLE;
+    }
+
+public:
+
+    /** Initialize the solver, see MaxSATSolver::MaxSATSolver */
+    IncrementalMaxSATSolver(int nVars, int nClausesEstimate = 8192)
+    : formula(nVars, nClausesEstimate)
+    , errorCode(0)
+    , lastStatus(MaxSATSolver::UNKNOWN)
+    , lastCost(UINT64_MAX)
+    , solvedClauses(0)
+    , solvedAtMostK(0)
+    , preprocessing(false)
+    , formulaRevision(0)
+    , preprocessedRevision(UINT64_MAX)
+    , preprocessedSoftClauses(false)
+    , preprocessedResult(false)
+    , stratification(false)
+    , localSearchFlips(0)
+    , warmStart(false)
+    , conflictMinimization(CONFLICT_DESTRUCTIVE)
+    , conflictBudget(-1)
+    , memoryLimit(0)
+    , solutionCache(0)
+    , detailedStatistics(false)
+    , statisticsStart(std::chrono::steady_clock::now())
+    {}
+
+    /** Return error number code in case the last call failed, see
+     *  MaxSATSolver::getErrno */
+    int getErrno() const { return errorCode; }
+
+    /** Drop the formula and the results of previous calls, to solve an
+     *  unrelated formula over the variables 1 to nVars
+     *
+     *  The memory allocated for the formula and the models is kept. The
+     *  statistics are cleared. Hence, resetting a solver is cheaper than
+     *  creating a new one.
+     *
+     *  @param withConfiguration if true, the configuration of the solver,
+     *         e.g. preprocessing, local search, memory limit, and solution
+     *         cache, is set to the defaults of a new solver. Otherwise, it is
+     *         kept.
+     */
+    void reset(int nVars, bool withConfiguration = false)
+    {
+        formula.clear(nVars);
+        formulaRevision++;
+        errorCode = 0;
+        lastStatus = MaxSATSolver::UNKNOWN;
+        lastModel.clear();
+        lastCost = UINT64_MAX;
+        solvedClauses = 0;
+        solvedAtMostK = 0;
+        resetStatistics();
+        if(!withConfiguration) return;
+        preprocessing = false;
+        stratification = false;
+        localSearchFlips = 0;
+        warmStart = false;
+        setConflictMinimization(CONFLICT_DESTRUCTIVE);
+        setMemoryLimit(0);
+        solutionCache = 0;
+        detailedStatistics = false;
+    }
+
+    /** Access the recorded formula */
+    const MaxSATInstance &getFormula() const { return formula; }
+
+    /** Simplify the formula before each call to the backend, see
+     *  MaxSATPreprocessor. The simplified formula is kept, and reused by
+     *  later calls with the same assumptions, until a constraint is added.
+     *  Disabled by default. */
+    void setPreprocessing(bool enable) { preprocessing = enable; }
+
+    /** Solve weighted formulas in levels of decreasing soft clause weights,
+     *  and harden soft clauses that cannot be falsified by an optimal model.
+     *  Levels are selected based on the diversity of the weights. Disabled by
+     *  default.
+     */
+    void setStratification(bool enable) { stratification = enable; }
+
+    /** Run a local search with the given number of flips before each call to
+     *  the backend, see MaxSATLocalSearch. Its best model is used as start
+     *  assignment, and its cost as upper bound for the backend. The value 0
+     *  disables the local search, which is the default.
+     */
+    void setLocalSearch(uint64_t flips) { localSearchFlips = flips; }
+
+    /** Use the start assignment as upper bound, in case it satisfies all hard
+     *  clauses and assumptions. The backend then only accepts models that
+     *  improve on the start assignment, and the start assignment is returned
+     *  if no better model exists. Without a given start assignment, the model
+     *  of the previous call is used. Disabled by default.
+     */
+    void setWarmStart(bool enable) { warmStart = enable; }
+
+    /** Select how the conflict of an unsatisfiable call with assumptions is
+     *  reduced
+     *
+     *  CONFLICT_NONE reports all assumptions. CONFLICT_PROPAGATION drops
+     *  assumptions as long as unit propagation shows that the remaining
+     *  ones are still unsatisfiable, which is cheap, but not minimal.
+     *  CONFLICT_DESTRUCTIVE, the default, additionally calls the backend
+     *  for candidates that propagation cannot decide, until the budget of
+     *  backend calls is exhausted.
+     *
+     *  @param budget number of backend calls per conflict, negative for no limit
+     */
+    void setConflictMinimization(ConflictMinimization method, int64_t budget = -1)
+    {
+        conflictMinimization = method;
+        conflictBudget = budget;
+    }
+
+    /** Collect timers per phase, the timeline of bounds, the effect of
+     *  preprocessing, and memory estimates, see Statistics. Collecting these
+     *  statistics reads the clock around each phase, and scans the formula
+     *  before each backend call. Disabled by default.
+     */
+    void setStatistics(bool enable) { detailedStatistics = enable; }
+
+    /** Statistics of the calls since the last resetStatistics */
+    const Statistics &getStatistics()
+    {
+        statistics.formulaBytes = formula.memoryUsage();
+        return statistics;
+    }
+
+    /** Clear the statistics, and restart the timeline */
+    void resetStatistics()
+    {
+        statistics = Statistics();
+        statisticsStart = std::chrono::steady_clock::now();
+    }
+
+    /** Look up and store optimal models in the given cache, which can be
+     *  shared with other solvers and threads, see MaxSATSolutionCache
+     *
+     *  Only compute_maxsat without assumptions uses the cache. If the cache
+     *  knows the formula, the stored model is returned without a search. If
+     *  it knows the hard part of the formula, the stored model is used as
+     *  start assignment and upper bound, as with setWarmStart, unless a start
+     *  assignment is given. The cache has to live as long as this solver
+     *  uses it. The value 0, the default, disables the cache.
+     */
+    void setSolutionCache(MaxSATSolutionCache *cache) { solutionCache = cache; }
+
+    /** Limit the memory of this solver to the given number of bytes
+     *
+     *  The limit applies to the recorded formula, see
+     *  MaxSATInstance::setMemoryLimit, and to each computation, where the
+     *  memory of the formula copies and of the backend is estimated before
+     *  the backend is called. In case the estimate exceeds the limit, the
+     *  backend is not called, and the best known model is returned as
+     *  SATISFIABLE, or UNKNOWN without a model, with error code -ENOMEM.
+     *  Known models come from the local search, the start assignment, or
+     *  lower levels of the stratification. The same applies, if the
+     *  backend fails with -ENOMEM. The value 0, the default, disables the
+     *  limit.
+     */
+    void setMemoryLimit(size_t bytes)
+    {
+        memoryLimit = bytes;
+        formula.setMemoryLimit(bytes);
+    }
+
+    /** Add a clause to the solver, see MaxSATSolver::addClause
+     *
+     *  Different to MaxSATSolver, this method can be called after a compute
+     *  method has been called.
+     */
+    bool addClause(const std::vector<int> &literals, uint64_t weight = 0)
+    {
+        const bool ret = formula.addClause(literals, weight);
+        formulaRevision++;
+        errorCode = formula.getErrno();
+        return ret;
+    }
+
+    /** Add an at-most-k constraint to the solver, see MaxSATSolver::addAtMostK
+     *
+     *  Different to MaxSATSolver, this method can be called after a compute
+     *  method has been called.
+     */
+    bool addAtMostK(const std::vector<int> &literals, const unsigned k)
+    {
+        const bool ret = formula.addAtMostK(literals, k);
+        formulaRevision++;
+        errorCode = formula.getErrno();
+        return ret;
+    }
+
+    /** Add an at-most-k constraint with the given encoding, see
+     *  MaxSATInstance::addAtMostK */
+    bool addAtMostK(const std::vector<int> &literals, const unsigned k,
+                    MaxSATInstance::CardinalityEncoding encoding)
+    {
+        const bool ret = formula.addAtMostK(literals, k, encoding);
+        formulaRevision++;
+        errorCode = formula.getErrno();
+        return ret;
+    }
+
+    /** Compute a MaxSAT solution for the formula added so far
+     *
+     *  The semantics of the parameters and the return value are the same as
+     *  for MaxSATSolver::compute_maxsat. If no startAssignment is given, the
+     *  model of the previous call is used instead.
+     */
+    MaxSATSolver::ReturnCode compute_maxsat(std::vector<int> &model,
+                                            uint64_t &cost,
+                                            uint64_t maxCost = UINT64_MAX,
+                                            const std::vector<int> *startAssignment = 0,
+                                            int64_t maxMinimizeSteps = -1)
+    {
+        errorCode = 0;
+        model.clear();
+        cost = UINT64_MAX;
+        statistics.calls++;
+
+        // adding constraints cannot make the formula satisfiable again
+        if(lastStatus == MaxSATSolver::UNSATISFIABLE)
+            return report(MaxSATSolver::UNSATISFIABLE, model, cost);
+
+        if(reusePreviousOptimum(model, cost, maxCost, 0))
+            return report(MaxSATSolver::OPTIMAL, model, cost);
+
+        const std::vector<int> *start = startAssignment;
+        if(!start && !lastModel.empty()) start = &lastModel;
+
+        MaxSATSolutionCache::Key key;
+        std::vector<int> cached;
+        bool boundedByCache = false;
+        if(solutionCache) {
+            MaxSATSolutionCache::fingerprint(formula, key);
+            uint64_t cachedCost = UINT64_MAX;
+            const MaxSATSolutionCache::Match match = solutionCache->lookup(formula, key, cached, cachedCost);
+            if(match == MaxSATSolutionCache::HIT && cachedCost < maxCost) {
+                model.swap(cached);
+                cost = cachedCost;
+                return report(MaxSATSolver::OPTIMAL, model, cost);
+            }
+            if(match != MaxSATSolutionCache::MISS && !startAssignment) {
+                start = &cached;
+                boundedByCache = true;
+            }
+        }
+
+        // the cached model bounds the search like a warm start
+        const bool previousWarmStart = warmStart;
+        warmStart = warmStart || boundedByCache;
+        MaxSATSolver::ReturnCode ret = solve(model, cost, 0, true, maxCost, start, maxMinimizeSteps);
+        warmStart = previousWarmStart;
+        if(solutionCache && ret == MaxSATSolver::OPTIMAL && !model.empty()) solutionCache->store(key, model, cost);
+        return report(ret, model, cost);
+    }
+
+    /** Compute a MaxSAT solution under a set of assumptions
+     *
+     *  The given literals are added as unit hard clauses for this call only,
+     *  i.e. they are not part of the formula for later calls. The semantics of
+     *  the other parameters and the return value are the same as for
+     *  MaxSATSolver::compute_maxsat.
+     *
+     *  In case the hard clauses together with the assumptions are
+     *  unsatisfiable, UNSATISFIABLE is returned, and conflict stores a subset
+     *  of the assumptions that is already unsatisfiable together with the
+     *  hard clauses. With the default conflict minimization, no assumption
+     *  can be removed from this subset, and the subset is empty, if the hard
+     *  clauses are unsatisfiable already, see setConflictMinimization.
+     *
+     *  Possible error codes:
+     *   -EINVAL ... an assumption is greater than the maximal variable, or 0
+     *
+     *  @param assumptions literals that have to be satisfied by the model
+     *  @param conflict stores responsible assumptions, if not 0
+     */
+    MaxSATSolver::ReturnCode compute_maxsat(const std::vector<int> &assumptions,
+                                            std::vector<int> &model,
+                                            uint64_t &cost,
+                                            std::vector<int> *conflict = 0,
+                                            uint64_t maxCost = UINT64_MAX,
+                                            const std::vector<int> *startAssignment = 0,
+                                            int64_t maxMinimizeSteps = -1)
+    {
+        errorCode = 0;
+        model.clear();
+        cost = UINT64_MAX;
+        if(conflict) conflict->clear();
+        statistics.calls++;
+
+        for(size_t i = 0 ; i < assumptions.size(); ++i) {
+            if(assumptions[i] == 0 || std::abs((int64_t)assumptions[i]) > formula.nVars()) {
+                errorCode = -EINVAL;
+                return MaxSATSolver::ERROR;
+            }
+        }
+
+        if(lastStatus == MaxSATSolver::UNSATISFIABLE) return MaxSATSolver::UNSATISFIABLE;
+
+        // the previous optimum stays optimal, if it satisfies the assumptions
+        if(reusePreviousOptimum(model, cost, maxCost, &assumptions)) return MaxSATSolver::OPTIMAL;
+
+        const std::vector<int> *start = startAssignment;
+        if(!start && !lastModel.empty()) start = &lastModel;
+
+        MaxSATSolver::ReturnCode ret = solve(model, cost, &assumptions, true, maxCost, start, maxMinimizeSteps);
+        if(ret == MaxSATSolver::UNSATISFIABLE && conflict)
+            ret = minimizeConflict(assumptions, *conflict);
+        return ret;
+    }
+};
+
+#endif
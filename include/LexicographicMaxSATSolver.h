@@ -0,0 +1,226 @@
+/**********************************************************************************[LexicographicMaxSATSolver.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef LexicographicMaxSATSolver_Interface_h
+#define LexicographicMaxSATSolver_Interface_h
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+#include "MaxSATInstance.h"
+#include "MaxSATSolver.h"
+
+/** Class to solve MaxSAT formulas with several prioritized objectives
+ *
+ *  Soft clauses are added to numbered objective levels, where level 0 is the
+ *  most important one. The levels are optimized one after the other: once
+ *  the optimum of a level is known, it is added as hard pseudo-Boolean
+ *  constraint on the relaxed soft clauses of this level, and the next level
+ *  is optimized on top. Hence, weights of different levels are never added
+ *  up, and each level only has to deal with its own weights.
+ *
+ *  Note: the backend cannot continue after compute_maxsat, so each level is
+ *  loaded into a fresh backend, together with the bounds of all previous
+ *  levels. The model of the previous level is used as start assignment.
+ */
+class LexicographicMaxSATSolver {
+
+    /** hard clauses and at-most-k constraints */
+    MaxSATInstance formula;
+
+    /** soft clauses per objective level */
+    std::vector<MaxSATInstance> objectives;
+
+    /** error code of the last failed call, see MaxSATSolver::getErrno */
+    int errorCode;
+
+    /** Explicitly disallow copy constructors */
+    LexicographicMaxSATSolver(const LexicographicMaxSATSolver& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    LexicographicMaxSATSolver& operator=(LexicographicMaxSATSolver const&) = delete;
+
+    /** Solve the given formula with a fresh backend */
+    MaxSATSolver::ReturnCode solve(const MaxSATInstance &problem, std::vector<int> &model, uint64_t &cost,
+                                   const std::vector<int> *startAssignment)
+    {
+        model.clear();
+        cost = UINT64_MAX;
+
+        // the backend does not accept empty formulas
+        if(problem.empty()) {
+            problem.makeModel(model);
+            cost = 0;
+            return MaxSATSolver::OPTIMAL;
+        }
+
+        MaxSATSolver solver(problem.nVars(), problem.nClauses());
+        MaxSATSolver::ReturnCode ret = MaxSATSolver::ERROR;
+        if(solver.getErrno() == 0 && problem.loadInto(solver))
+            ret = solver.compute_maxsat(model, cost, UINT64_MAX, startAssignment);
+        errorCode = solver.getErrno();
+        return ret;
+    }
+
+    /** Require that the soft clauses of the given level cost at most bound
+     *
+     *  Each soft clause C with weight w is relaxed into the hard clause
+     *  (C | r) with a fresh variable r, and sum(w * r) <= bound is added.
+     *  Unit soft clauses (l) use ~l instead of a fresh variable. If the bound
+     *  is 0, the soft clauses are added as hard clauses.
+     */
+    bool addBound(MaxSATInstance &problem, const MaxSATInstance &objective, uint64_t bound)
+    {
+        std::vector<int> literals, relaxed;
+        std::vector<uint64_t> weights;
+        for(size_t i = 0; i < objective.nClauses(); ++i) {
+            relaxed.assign(objective.clause(i), objective.clause(i) + objective.clauseSize(i));
+            if(bound != 0 && relaxed.size() == 1) {
+                literals.push_back(-relaxed[0]);
+            } else if(bound != 0) {
+                literals.push_back(problem.newVar());
+                relaxed.push_back(literals.back());
+            }
+            if(bound != 0) weights.push_back(objective.weight(i));
+            if((bound == 0 || relaxed.size() > 1) && !problem.addClause(relaxed)) {
+                errorCode = problem.getErrno();
+                return false;
+            }
+        }
+        if(bound != 0 && !problem.addPB(literals, weights, bound)) {
+            errorCode = problem.getErrno();
+            return false;
+        }
+        return true;
+    }
+
+public:
+
+    /** Initialize the solver for formulas over the given variables
+     *
+     *  @param nVars number of variables that can be used in constraints
+     */
+    LexicographicMaxSATSolver(int nVars)
+    : formula(nVars)
+    , errorCode(0)
+    {}
+
+    /** Return error number code in case the last call failed, see
+     *  MaxSATSolver::getErrno */
+    int getErrno() const { return errorCode; }
+
+    /** Number of objective levels, i.e. the highest used level plus 1 */
+    size_t nLevels() const { return objectives.size(); }
+
+    /** Add a hard clause, see MaxSATSolver::addClause */
+    bool addClause(const std::vector<int> &literals)
+    {
+        const bool ret = formula.addClause(literals);
+        errorCode = formula.getErrno();
+        return ret;
+    }
+
+    /** Add an at-most-k constraint, see MaxSATSolver::addAtMostK */
+    bool addAtMostK(const std::vector<int> &literals, const unsigned k)
+    {
+        const bool ret = formula.addAtMostK(literals, k);
+        errorCode = formula.getErrno();
+        return ret;
+    }
+
+    /** Add a soft clause to an objective level
+     *
+     *  Possible error codes:
+     *   -EINVAL ... a literal is greater than the maximal variable, or 0, or
+     *               the weight is 0
+     *   -ENOMEM ... the level cannot be created
+     *
+     *  @param level objective level, where 0 is the most important one
+     *  @return true, if the clause was added
+     */
+    bool addSoftClause(const std::vector<int> &literals, uint64_t weight, unsigned level)
+    {
+        errorCode = 0;
+        if(weight == 0) {
+            errorCode = -EINVAL;
+            return false;
+        }
+        try {
+            while(objectives.size() <= level) objectives.push_back(MaxSATInstance(formula.nVars()));
+        } catch (std::exception &e) {
+            errorCode = -ENOMEM;
+            return false;
+        }
+        const bool ret = objectives[level].addClause(literals, weight);
+        errorCode = objectives[level].getErrno();
+        return ret;
+    }
+
+    /** Compute a model that is optimal for all objective levels in order
+     *
+     *  Possible error codes: see MaxSATSolver::compute_maxsat
+     *
+     *  @param model stores the model, in the format of MaxSATSolver::compute_maxsat
+     *  @param costs stores the cost of the model for each objective level
+     *  @param startAssignment see MaxSATSolver::compute_maxsat
+     *
+     *  @return OPTIMAL, if all levels have been optimized
+     *          UNSATISFIABLE, if the hard clauses are unsatisfiable
+     *          UNKNOWN, if the optimum of a level could not be proven, such
+     *                   that the following levels cannot be optimized
+     *          ERROR, if the backend failed, or a bound could not be added
+     */
+    MaxSATSolver::ReturnCode compute_maxsat(std::vector<int> &model,
+                                            std::vector<uint64_t> &costs,
+                                            const std::vector<int> *startAssignment = 0)
+    {
+        errorCode = 0;
+        model.clear();
+        costs.assign(objectives.size(), 0);
+
+        MaxSATInstance problem(formula);
+        std::vector<int> levelModel, previous;
+        const std::vector<int> *start = startAssignment;
+        MaxSATSolver::ReturnCode ret = MaxSATSolver::OPTIMAL;
+        size_t level = 0;
+        do {
+            MaxSATInstance current(problem);
+            if(level < objectives.size()) {
+                const MaxSATInstance &objective = objectives[level];
+                for(size_t i = 0; i < objective.nClauses(); ++i) {
+                    if(!current.addClause(objective.clause(i), objective.clauseSize(i), objective.weight(i))) {
+                        errorCode = current.getErrno();
+                        return MaxSATSolver::ERROR;
+                    }
+                }
+            }
+
+            uint64_t cost = 0;
+            ret = solve(current, levelModel, cost, start);
+            if(ret != MaxSATSolver::OPTIMAL) {
+                costs.clear();
+                // the error code of the backend is kept
+                return ret == MaxSATSolver::SATISFIABLE ? MaxSATSolver::UNKNOWN : ret;
+            }
+            previous.swap(levelModel);
+            start = &previous;
+
+            if(level < objectives.size()) {
+                costs[level] = cost;
+                if(level + 1 < objectives.size() && !addBound(problem, objectives[level], cost)) return MaxSATSolver::ERROR;
+            }
+        } while(++level < objectives.size());
+
+        // auxiliary variables of the bounds are not part of the model
+        model.assign(previous.begin(), previous.begin() + std::min(previous.size(), (size_t)formula.nVars() + 1));
+        return MaxSATSolver::OPTIMAL;
+    }
+};
+
+#endif
@@ -0,0 +1,269 @@
+/**********************************************************************************[MaxSATCoreExtractor.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATCoreExtractor_Interface_h
+#define MaxSATCoreExtractor_Interface_h
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <unordered_map>
+#include <vector>
+
+#include "IncrementalMaxSATSolver.h"
+#include "MaxSATInstance.h"
+#include "MaxSATSolver.h"
+
+/** Class to find the hard constraints that make a formula unsatisfiable
+ *
+ *  Clauses and at-most-k constraints are added with an ID chosen by the
+ *  caller, and several constraints can share an ID to form a group. Each
+ *  group is guarded by a selector variable, i.e. a clause C of the group is
+ *  added as (C | -s), and an at-most-k constraint over n literals with bound
+ *  k is added as at-most-n over its literals and n - k fresh literals that
+ *  are implied by s. Background constraints are added without a selector,
+ *  and are never part of a core.
+ *
+ *  computeCore assumes all selectors, and reduces the selectors of an
+ *  unsatisfiable call with the conflict minimization of
+ *  IncrementalMaxSATSolver: unit propagation first, and then deletion of
+ *  chunks of groups, where each candidate is checked by a backend call. The
+ *  backend cannot be reused after a call, so each check loads the formula
+ *  into a fresh backend.
+ *
+ *  Possible error codes:
+ *   -EINVAL ... a literal is greater than the maximal variable, or 0
+ *   -ENOMEM ... a constraint cannot be stored
+ */
+class MaxSATCoreExtractor {
+
+    /** group of background constraints */
+    static const size_t noGroup = SIZE_MAX;
+
+    /** all constraints, with at-most-k constraints left to the library */
+    MaxSATInstance formula;
+
+    /** group of each clause and at-most-k constraint of formula */
+    std::vector<size_t> clauseGroups;
+    std::vector<size_t> amkGroups;
+
+    /** ID of each group, and group of each ID */
+    std::vector<uint64_t> groupIds;
+    std::unordered_map<uint64_t, size_t> groups;
+
+    /** error code of the last failed call */
+    int errorCode;
+
+    /** budget of backend calls per core, negative for no limit */
+    int64_t budget;
+
+    /** backend calls of the last computeCore */
+    uint64_t backendCalls;
+
+    /** Explicitly disallow copy constructors */
+    MaxSATCoreExtractor(const MaxSATCoreExtractor& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    MaxSATCoreExtractor& operator=(MaxSATCoreExtractor const&) = delete;
+
+    /** Assign the constraints that have been added last to a group */
+    bool assignGroup(bool added, size_t group)
+    {
+        errorCode = formula.getErrno();
+        if(!added) return false;
+        try {
+            clauseGroups.resize(formula.nClauses(), group);
+            amkGroups.resize(formula.nAtMostK(), group);
+        } catch (std::exception &e) {
+            errorCode = -ENOMEM;
+            return false;
+        }
+        return true;
+    }
+
+    /** Return the group of an ID, and create it if necessary */
+    bool findGroup(uint64_t id, size_t &group)
+    {
+        try {
+            std::unordered_map<uint64_t, size_t>::iterator it = groups.find(id);
+            if(it == groups.end()) {
+                it = groups.insert(std::make_pair(id, groupIds.size())).first;
+                groupIds.push_back(id);
+            }
+            group = it->second;
+        } catch (std::exception &e) {
+            errorCode = -ENOMEM;
+            return false;
+        }
+        return true;
+    }
+
+    /** Add the formula with selectors to a solver, where the selector of
+     *  group g is the variable nVars + 1 + g */
+    bool loadInto(IncrementalMaxSATSolver &solver) const
+    {
+        const int nVars = formula.nVars();
+        int nextVar = nVars + (int)groupIds.size();
+        std::vector<int> literals;
+        for(size_t i = 0; i < formula.nClauses(); ++i) {
+            if(formula.weight(i) != 0) continue;
+            literals.assign(formula.clause(i), formula.clause(i) + formula.clauseSize(i));
+            if(clauseGroups[i] != noGroup) literals.push_back(-(nVars + 1 + (int)clauseGroups[i]));
+            if(!solver.addClause(literals)) return false;
+        }
+        for(size_t i = 0; i < formula.nAtMostK(); ++i) {
+            const size_t n = formula.atMostKSize(i);
+            const unsigned k = formula.atMostKBound(i);
+            if(k >= n) continue;
+            literals.assign(formula.atMostK(i), formula.atMostK(i) + n);
+            if(amkGroups[i] == noGroup) {
+                if(!solver.addAtMostK(literals, k)) return false;
+                continue;
+            }
+            // the fresh literals are free without the selector
+            const int selector = nVars + 1 + (int)amkGroups[i];
+            for(size_t j = k; j < n; ++j) {
+                literals.push_back(++nextVar);
+                if(!solver.addClause({-selector, nextVar})) return false;
+            }
+            if(!solver.addAtMostK(literals, n)) return false;
+        }
+        return true;
+    }
+
+    /** Number of variables of the formula with selectors */
+    size_t selectorFormulaVars() const
+    {
+        size_t vars = formula.nVars() + groupIds.size();
+        for(size_t i = 0; i < formula.nAtMostK(); ++i)
+            if(amkGroups[i] != noGroup && formula.atMostKBound(i) < formula.atMostKSize(i))
+                vars += formula.atMostKSize(i) - formula.atMostKBound(i);
+        return vars;
+    }
+
+public:
+
+    /** Create an empty formula over the variables 1 to nVars */
+    MaxSATCoreExtractor(int nVars, int nClausesEstimate = 8192)
+    : formula(nVars, nClausesEstimate), errorCode(0), budget(-1), backendCalls(0)
+    {}
+
+    /** Return error code of the last failed call, or 0 */
+    int getErrno() const { return errorCode; }
+
+    /** Limit the backend calls to reduce a core. With a limit, the reported
+     *  core might still contain groups that can be dropped. The default -1
+     *  results in cores from which no group can be dropped. */
+    void setBudget(int64_t backendCallBudget) { budget = backendCallBudget; }
+
+    /** Number of backend calls of the last computeCore */
+    uint64_t getBackendCalls() const { return backendCalls; }
+
+    /** Number of groups, i.e. different IDs that have been used */
+    size_t nGroups() const { return groupIds.size(); }
+
+    /** Add a hard clause to the group with the given ID */
+    bool addClause(const std::vector<int> &literals, uint64_t id)
+    {
+        size_t group = 0;
+        if(!findGroup(id, group)) return false;
+        return assignGroup(formula.addClause(literals), group);
+    }
+
+    /** Add an at-most-k constraint to the group with the given ID */
+    bool addAtMostK(const std::vector<int> &literals, const unsigned k, uint64_t id)
+    {
+        size_t group = 0;
+        if(!findGroup(id, group)) return false;
+        return assignGroup(formula.addAtMostK(literals, k, MaxSATInstance::LIBRARY), group);
+    }
+
+    /** Add a hard clause that is always enforced */
+    bool addBackgroundClause(const std::vector<int> &literals)
+    {
+        return assignGroup(formula.addClause(literals), noGroup);
+    }
+
+    /** Add an at-most-k constraint that is always enforced */
+    bool addBackgroundAtMostK(const std::vector<int> &literals, const unsigned k)
+    {
+        return assignGroup(formula.addAtMostK(literals, k, MaxSATInstance::LIBRARY), noGroup);
+    }
+
+    /** Add the hard part of a formula, where hard clause i gets the ID i,
+     *  and at-most-k constraint j the ID input.nClauses() + j. Soft clauses
+     *  are ignored. The formula must not use more variables than this one.
+     */
+    bool addHardConstraints(const MaxSATInstance &input)
+    {
+        if(input.nVars() > formula.nVars()) {
+            errorCode = -EINVAL;
+            return false;
+        }
+        std::vector<int> literals;
+        for(size_t i = 0; i < input.nClauses(); ++i) {
+            if(input.weight(i) != 0) continue;
+            literals.assign(input.clause(i), input.clause(i) + input.clauseSize(i));
+            if(!addClause(literals, i)) return false;
+        }
+        for(size_t i = 0; i < input.nAtMostK(); ++i) {
+            literals.assign(input.atMostK(i), input.atMostK(i) + input.atMostKSize(i));
+            if(!addAtMostK(literals, input.atMostKBound(i), input.nClauses() + i)) return false;
+        }
+        return true;
+    }
+
+    /** Find a set of groups that is unsatisfiable together with the
+     *  background constraints
+     *
+     *  @param core stores the IDs of the responsible groups, in the order of
+     *         their first use. No group can be dropped from the core, unless
+     *         the budget of backend calls is exhausted. The core is empty, if
+     *         the background constraints are unsatisfiable already.
+     *  @return UNSATISFIABLE, if a core has been found, SATISFIABLE, if all
+     *          groups together are satisfiable, and ERROR otherwise
+     */
+    MaxSATSolver::ReturnCode computeCore(std::vector<uint64_t> &core)
+    {
+        errorCode = 0;
+        core.clear();
+        backendCalls = 0;
+
+        const size_t vars = selectorFormulaVars();
+        if(vars > INT32_MAX) {
+            errorCode = -ENOMEM;
+            return MaxSATSolver::ERROR;
+        }
+        std::vector<int> selectors, model, conflict;
+        uint64_t cost = 0;
+        try {
+            IncrementalMaxSATSolver solver(vars, formula.nClauses() + vars);
+            solver.setConflictMinimization(IncrementalMaxSATSolver::CONFLICT_DESTRUCTIVE, budget);
+            if(!loadInto(solver)) {
+                errorCode = solver.getErrno();
+                return MaxSATSolver::ERROR;
+            }
+            for(size_t g = 0; g < groupIds.size(); ++g) selectors.push_back(formula.nVars() + 1 + (int)g);
+
+            MaxSATSolver::ReturnCode ret = solver.compute_maxsat(selectors, model, cost, &conflict);
+            backendCalls = solver.getStatistics().backendCalls;
+            if(ret == MaxSATSolver::OPTIMAL || ret == MaxSATSolver::SATISFIABLE) return MaxSATSolver::SATISFIABLE;
+            if(ret != MaxSATSolver::UNSATISFIABLE) {
+                errorCode = solver.getErrno();
+                return MaxSATSolver::ERROR;
+            }
+            for(size_t i = 0; i < conflict.size(); ++i) core.push_back(groupIds[conflict[i] - formula.nVars() - 1]);
+        } catch (std::exception &e) {
+            core.clear();
+            errorCode = -ENOMEM;
+            return MaxSATSolver::ERROR;
+        }
+        return MaxSATSolver::UNSATISFIABLE;
+    }
+};
+
+#endif
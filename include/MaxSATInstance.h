@@ -0,0 +1,1109 @@
+/**********************************************************************************[MaxSATInstance.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATInstance_Interface_h
+#define MaxSATInstance_Interface_h
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "MaxSATSolver.h"
+
+/** Class to store a (weighted) MaxSAT formula independently of a solver
+ *
+ *  The MaxSATSolver interface consumes a formula exactly once, and cannot be
+ *  modified anymore after a compute method has been called. This class keeps
+ *  a copy of all added clauses and at-most-k constraints, so that the formula
+ *  can be evaluated on a model, and loaded into a (fresh) MaxSATSolver as
+ *  often as necessary.
+ *
+ *  All literals of all clauses are stored in a single flat buffer, where each
+ *  clause is terminated by 0 (as in the DIMACS format). The weight of a soft
+ *  clause is stored in the two elements in front of its literals, so that
+ *  hard clauses do not store a weight. Clauses are referenced by 32 bit
+ *  offsets into this buffer, where the highest bit marks soft clauses. The
+ *  same layout, without weights, is used for the at-most-k constraints.
+ *
+ *  Hence, the literals of all clauses, including the 0s and the weights of
+ *  soft clauses, are limited to 2^31 elements. The same limit applies to the
+ *  literals of all at-most-k constraints.
+ */
+class MaxSATInstance {
+
+public:
+
+    /** Encodings for at-most-k constraints
+     *
+     *  LIBRARY stores the constraint, and leaves encoding it to the
+     *  MaxSATSolver backend, except for k == 0, which is always added as
+     *  unit clauses, because the backend ignores such constraints. AUTOMATIC
+     *  selects an encoding based on the size n of the constraint and its
+     *  bound k: constraints with k >= n are
+     *  dropped, k == 0 and k == n - 1 result in units and a single clause,
+     *  at-most-one constraints use PAIRWISE up to 5 literals and LADDER
+     *  otherwise, and all remaining constraints are left to the library.
+     *  PAIRWISE and LADDER only apply to k == 1, and SEQUENTIAL_COUNTER
+     *  results in O(n*k) clauses and auxiliary variables. For other bounds,
+     *  these encodings fall back to LIBRARY.
+     */
+    enum CardinalityEncoding
+    {
+        LIBRARY = 0,
+        AUTOMATIC = 1,
+        PAIRWISE = 2,
+        LADDER = 3,
+        SEQUENTIAL_COUNTER = 4,
+    };
+
+    /** Number of constraints added with an encoding, and the number of
+     *  clauses and auxiliary variables that their encoding introduced */
+    struct EncodingStatistics {
+        uint64_t constraints;
+        uint64_t clauses;
+        uint64_t variables;
+
+        EncodingStatistics() : constraints(0), clauses(0), variables(0) {}
+    };
+
+private:
+
+    /** highest variable that can be used in this formula */
+    int maxVar;
+
+    /** error code of the last failed call, see MaxSATSolver::getErrno */
+    int errorCode;
+
+    /** encoding used for at-most-k constraints, if not specified */
+    CardinalityEncoding cardinalityEncoding;
+
+    /** maximal number of bytes for stored constraints, 0 for no limit */
+    size_t memoryLimit;
+
+    /** number of additions that have been rejected due to the limits */
+    uint64_t rejectedAdditions;
+
+    /** statistics per cardinality encoding, followed by pseudo-Boolean
+     *  constraints */
+    EncodingStatistics encodingStatistics[SEQUENTIAL_COUNTER + 2];
+
+    /** marks offsets of soft clauses, and limits the size of the buffers */
+    static const uint32_t softFlag = 1u << 31;
+
+    /** literals of all clauses, each clause is terminated by 0, and soft
+     *  clauses are preceded by their weight */
+    std::vector<int> clauseLiterals;
+
+    /** position of the first literal of each clause in clauseLiterals, the
+     *  highest bit is set for soft clauses */
+    std::vector<uint32_t> clauseStarts;
+
+    /** literals of all at-most-k constraints, each terminated by 0 */
+    std::vector<int> amkLiterals;
+
+    /** position of the first literal of each constraint in amkLiterals */
+    std::vector<uint32_t> amkStarts;
+
+    /** bound k of each at-most-k constraint */
+    std::vector<unsigned> amkBounds;
+
+    /** Header of the binary format of serialize, followed by the buffers in
+     *  the order of the sizes, each padded to a multiple of 8 bytes */
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        int32_t maxVar;
+        int32_t cardinalityEncoding;
+        uint64_t sizes[5];
+        uint64_t statistics[3 * (SEQUENTIAL_COUNTER + 2)];
+    };
+
+    /** Bytes of a buffer in the binary format */
+    static size_t paddedBytes(size_t elements) { return (elements * sizeof(int) + 7) / 8 * 8; }
+
+    /** Copy a buffer of the binary format, and advance the position */
+    template<typename T>
+    static void readSection(const char *&pos, std::vector<T> &buffer, uint64_t elements)
+    {
+        buffer.resize(elements);
+        if(elements) memcpy(buffer.data(), pos, elements * sizeof(T));
+        pos += paddedBytes(elements);
+    }
+
+    /** Append a buffer in the binary format */
+    template<typename T>
+    static void writeSection(char *&pos, const std::vector<T> &buffer)
+    {
+        if(!buffer.empty()) memcpy(pos, buffer.data(), buffer.size() * sizeof(T));
+        pos += paddedBytes(buffer.size());
+    }
+
+    /** Check that the buffers read from the binary format form a formula,
+     *  i.e. the constraints follow each other without gaps, each constraint
+     *  is terminated by 0, and all literals are valid */
+    bool validSnapshot() const
+    {
+        if(amkBounds.size() != amkStarts.size()) return false;
+        size_t pos = 0;
+        for(size_t i = 0; i < clauseStarts.size(); ++i) {
+            if(clauseStarts[i] & softFlag) pos += 2;
+            if(literalStart(i) != pos || pos > clauseLiterals.size()) return false;
+            for(; pos < clauseLiterals.size() && clauseLiterals[pos] != 0; ++pos)
+                if(std::abs((int64_t)clauseLiterals[pos]) > maxVar) return false;
+            if(pos++ == clauseLiterals.size()) return false;
+        }
+        if(pos != clauseLiterals.size()) return false;
+        pos = 0;
+        for(size_t i = 0; i < amkStarts.size(); ++i) {
+            if(amkStarts[i] != pos) return false;
+            for(; pos < amkLiterals.size() && amkLiterals[pos] != 0; ++pos)
+                if(std::abs((int64_t)amkLiterals[pos]) > maxVar) return false;
+            if(pos++ == amkLiterals.size()) return false;
+        }
+        return pos == amkLiterals.size();
+    }
+
+    /** Position of the first literal of clause i */
+    size_t literalStart(size_t i) const { return clauseStarts[i] & ~softFlag; }
+
+    /** Number of bytes used by the stored constraints, without the unused
+     *  capacity of the buffers */
+    size_t storedBytes() const
+    {
+        return (clauseLiterals.size() + amkLiterals.size()) * sizeof(int) +
+               (clauseStarts.size() + amkStarts.size()) * sizeof(uint32_t) + amkBounds.size() * sizeof(unsigned);
+    }
+
+    /** Check whether additional elements, and the offsets of the given number
+     *  of constraints, still fit into a buffer and the memory limit */
+    bool fits(size_t used, size_t additional, size_t constraints = 1)
+    {
+        const size_t bytes = additional * sizeof(int) + constraints * (sizeof(uint32_t) + sizeof(unsigned));
+        if(additional < softFlag && used < softFlag - additional &&
+           (memoryLimit == 0 || (bytes <= memoryLimit && storedBytes() <= memoryLimit - bytes))) return true;
+        errorCode = -ENOMEM;
+        rejectedAdditions++;
+        return false;
+    }
+
+    /** Sizes of the formula, to undo partially encoded constraints */
+    struct Checkpoint {
+        int maxVar;
+        size_t clauseLiterals, clauseStarts, amkLiterals, amkStarts;
+        uint64_t rejectedAdditions;
+    };
+
+    /** Current sizes of the formula */
+    Checkpoint checkpoint() const
+    {
+        Checkpoint c = {maxVar, clauseLiterals.size(), clauseStarts.size(), amkLiterals.size(), amkStarts.size(),
+                        rejectedAdditions};
+        return c;
+    }
+
+    /** Check that no addition has been rejected since the checkpoint, and
+     *  count the encoded constraint in the given statistics. Otherwise,
+     *  remove all constraints and variables added since, and fail with
+     *  -ENOMEM, so that no partial encoding is kept.
+     */
+    bool encodedCompletely(const Checkpoint &c, EncodingStatistics &statistics)
+    {
+        if(rejectedAdditions == c.rejectedAdditions) {
+            statistics.constraints++;
+            statistics.clauses += clauseStarts.size() - c.clauseStarts;
+            statistics.variables += maxVar - c.maxVar;
+            return true;
+        }
+        maxVar = c.maxVar;
+        clauseLiterals.resize(c.clauseLiterals);
+        clauseStarts.resize(c.clauseStarts);
+        amkLiterals.resize(c.amkLiterals);
+        amkStarts.resize(c.amkStarts);
+        amkBounds.resize(c.amkStarts);
+        errorCode = -ENOMEM;
+        return false;
+    }
+
+    /** Append the weight of a soft clause, and the offset of its literals */
+    void startClause(uint64_t weight)
+    {
+        if(weight == 0) {
+            clauseStarts.push_back(clauseLiterals.size());
+            return;
+        }
+        int halves[2];
+        memcpy(halves, &weight, sizeof(weight));
+        clauseLiterals.push_back(halves[0]);
+        clauseLiterals.push_back(halves[1]);
+        clauseStarts.push_back(clauseLiterals.size() | softFlag);
+    }
+
+    /** Check that all literals are in the range of the formula */
+    bool validLiterals(const int *literals, size_t size)
+    {
+        for(size_t i = 0 ; i < size; ++i) {
+            if(literals[i] == 0 || std::abs((int64_t)literals[i]) > maxVar) {
+                errorCode = -EINVAL;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** Find the representative of a variable in a union find structure */
+    static int findRoot(std::vector<int> &parent, int v)
+    {
+        while(parent[v] != v) v = parent[v] = parent[parent[v]];
+        return v;
+    }
+
+    /** Node values of the decision diagram of a PB constraint, that are
+     *  not represented by a variable */
+    enum { pbFalse = 0, pbTrue = -1 };
+
+    /** Interval [low, high] of bounds, for which the same node represents
+     *  the suffix of a PB constraint */
+    struct PBNode {
+        int64_t high;
+        int node;
+    };
+
+    /** Node of the decision diagram that is still being encoded, step counts
+     *  the children that have been requested already */
+    struct PBFrame {
+        size_t i;
+        int64_t bound;
+        int step;
+        int ifTrue;
+        int64_t lowTrue, highTrue;
+    };
+
+    /** Add two non-negative values, saturating at INT64_MAX */
+    static int64_t saturatingAdd(int64_t a, int64_t b)
+    {
+        return a > INT64_MAX - b ? INT64_MAX : a + b;
+    }
+
+    /** Find the node for "sum(coefficients[j] * literals[j], j >= i) <= bound",
+     *  if it is constant or has been encoded already
+     *
+     *  A saturated suffix sum is never treated as satisfied, as the actual sum
+     *  might exceed the bound.
+     */
+    static bool findPBNode(size_t i, int64_t bound, const std::vector<int64_t> &suffixSum,
+                           const std::vector<std::map<int64_t, PBNode> > &nodes,
+                           int &node, int64_t &low, int64_t &high)
+    {
+        if(bound < 0) { low = INT64_MIN; high = -1; node = pbFalse; return true; }
+        if(bound >= suffixSum[i] && suffixSum[i] != INT64_MAX) {
+            low = suffixSum[i]; high = INT64_MAX; node = pbTrue; return true;
+        }
+        if(i == nodes.size()) return false;
+
+        std::map<int64_t, PBNode>::const_iterator it = nodes[i].upper_bound(bound);
+        if(it == nodes[i].begin()) return false;
+        --it;
+        if(it->second.high < bound) return false;
+        low = it->first;
+        high = it->second.high;
+        node = it->second.node;
+        return true;
+    }
+
+    /** Encode "sum(coefficients[j] * literals[j]) <= bound" as decision
+     *  diagram, and return the variable that implies the constraint, or
+     *  pbTrue or pbFalse
+     *
+     *  Nodes are shared among all bounds of the interval [low, high], which
+     *  results in the same constraint on the given literals. The diagram is
+     *  built with an explicit stack of open nodes, as its depth is the number
+     *  of literals.
+     */
+    int encodePB(int64_t bound, const std::vector<int> &literals, const std::vector<int64_t> &coefficients,
+                 const std::vector<int64_t> &suffixSum, std::vector<std::map<int64_t, PBNode> > &nodes)
+    {
+        int node = pbFalse;
+        int64_t low = 0, high = 0;
+        std::vector<PBFrame> open;
+        if(findPBNode(0, bound, suffixSum, nodes, node, low, high)) return node;
+        PBFrame root = {0, bound, 0, pbFalse, 0, 0};
+        open.push_back(root);
+
+        // node, low and high always hold the result of the last finished node
+        std::vector<int> clause;
+        while(!open.empty()) {
+            PBFrame &frame = open.back();
+            const size_t i = frame.i;
+            const int64_t c = coefficients[i];
+
+            if(frame.step == 0) {
+                frame.step = 1;
+                PBFrame child = {i + 1, frame.bound - c, 0, pbFalse, 0, 0};
+                if(!findPBNode(child.i, child.bound, suffixSum, nodes, node, low, high)) {
+                    open.push_back(child);
+                    continue;
+                }
+            }
+            if(frame.step == 1) {
+                frame.step = 2;
+                frame.ifTrue = node;
+                frame.lowTrue = low;
+                frame.highTrue = high;
+                PBFrame child = {i + 1, frame.bound, 0, pbFalse, 0, 0};
+                if(!findPBNode(child.i, child.bound, suffixSum, nodes, node, low, high)) {
+                    open.push_back(child);
+                    continue;
+                }
+            }
+
+            const int ifTrue = frame.ifTrue, ifFalse = node;
+            low = std::max(frame.lowTrue == INT64_MIN ? INT64_MIN : saturatingAdd(frame.lowTrue, c), low);
+            high = std::min(saturatingAdd(frame.highTrue, c), high);
+
+            // a node only has to imply the constraint, as it is used positively
+            node = ifFalse;
+            if(ifTrue != ifFalse) {
+                node = newVar();
+                if(ifTrue != pbTrue) {
+                    clause.assign(1, -node);
+                    clause.push_back(-literals[i]);
+                    if(ifTrue != pbFalse) clause.push_back(ifTrue);
+                    addClause(clause);
+                }
+                if(ifFalse != pbTrue) {
+                    clause.assign(1, -node);
+                    clause.push_back(ifFalse);
+                    addClause(clause);
+                }
+            }
+            PBNode entry = {high, node};
+            nodes[i][low] = entry;
+            open.pop_back();
+        }
+        return node;
+    }
+
+    /** Encode an at-most-k constraint into hard clauses
+     *
+     *  PAIRWISE and LADDER are only used for k == 1. The constraints
+     *  k == 0, k == n - 1, and k >= n are encoded directly.
+     */
+    void encodeAtMostK(const std::vector<int> &literals, unsigned k, CardinalityEncoding encoding)
+    {
+        const size_t n = literals.size();
+        std::vector<int> clause;
+        if(k >= n) return;
+        if(k == 0) {
+            for(size_t i = 0; i < n; ++i) addClause(std::vector<int>(1, -literals[i]));
+            return;
+        }
+        if(k + 1 == n) {
+            for(size_t i = 0; i < n; ++i) clause.push_back(-literals[i]);
+            addClause(clause);
+            return;
+        }
+
+        if(encoding == PAIRWISE) {
+            clause.resize(2);
+            for(size_t i = 0; i < n; ++i) {
+                for(size_t j = i + 1; j < n; ++j) {
+                    clause[0] = -literals[i];
+                    clause[1] = -literals[j];
+                    addClause(clause);
+                }
+            }
+        } else if(encoding == LADDER) {
+            // s_i is true, if one of the first i literals is true
+            int previous = 0;
+            for(size_t i = 0; i < n; ++i) {
+                const int current = i + 1 < n ? newVar() : 0;
+                if(current) { clause.assign(1, -literals[i]); clause.push_back(current); addClause(clause); }
+                if(previous) {
+                    clause.assign(1, -literals[i]); clause.push_back(-previous); addClause(clause);
+                    if(current) { clause.assign(1, -previous); clause.push_back(current); addClause(clause); }
+                }
+                previous = current;
+            }
+        } else {
+            // counter[j] of position i is true, if at least j+1 of the first i literals are true
+            std::vector<int> previous, current(k, 0);
+            for(size_t i = 0; i < n; ++i) {
+                if(i + 1 < n) for(unsigned j = 0; j < k; ++j) current[j] = newVar();
+                for(unsigned j = 0; i + 1 < n && j < k; ++j) {
+                    if(j == 0) { clause.assign(1, -literals[i]); clause.push_back(current[0]); addClause(clause); }
+                    if(previous.empty()) continue;
+                    clause.assign(1, -previous[j]); clause.push_back(current[j]); addClause(clause);
+                    if(j > 0) {
+                        clause.assign(1, -literals[i]); clause.push_back(-previous[j - 1]); clause.push_back(current[j]);
+                        addClause(clause);
+                    }
+                }
+                if(!previous.empty()) { clause.assign(1, -literals[i]); clause.push_back(-previous[k - 1]); addClause(clause); }
+                previous = current;
+            }
+        }
+    }
+
+public:
+
+    /** Create an empty formula over the variables 1 to nVars
+     *
+     *  @param nVars highest variable in the input problem
+     *  @param nClausesEstimate rough estimate number of clauses, used to
+     *         reserve space
+     */
+    MaxSATInstance(int nVars = 0, int nClausesEstimate = 0)
+    : maxVar(nVars < 0 ? 0 : nVars), errorCode(0), cardinalityEncoding(LIBRARY), memoryLimit(0), rejectedAdditions(0)
+    {
+        if(nClausesEstimate > 0) clauseStarts.reserve(nClausesEstimate);
+    }
+
+    /** Return error code of the last failed call, or 0 */
+    int getErrno() const { return errorCode; }
+
+    /** Highest variable of the formula */
+    int nVars() const { return maxVar; }
+
+    /** Introduce a fresh variable, and return it */
+    int newVar() { return ++maxVar; }
+
+    /** Make sure the variables up to nVars can be used in the formula */
+    void reserveVars(int nVars) { if(nVars > maxVar) maxVar = nVars; }
+
+    /** Add a clause, semantics as MaxSATSolver::addClause */
+    bool addClause(const std::vector<int> &literals, uint64_t weight = 0)
+    {
+        return addClause(literals.data(), literals.size(), weight);
+    }
+
+    /** Add a clause given as plain array of size literals
+     *
+     *  Possible error codes:
+     *   -EINVAL ... a literal is greater than the maximal variable, or 0
+     *   -ENOMEM ... the clause does not fit into the formula anymore
+     */
+    bool addClause(const int *literals, size_t size, uint64_t weight = 0)
+    {
+        if(!validLiterals(literals, size) || !fits(clauseLiterals.size(), size + 3)) return false;
+        errorCode = 0;
+        startClause(weight);
+        clauseLiterals.insert(clauseLiterals.end(), literals, literals + size);
+        clauseLiterals.push_back(0);
+        return true;
+    }
+
+    /** Add many clauses at once
+     *
+     *  The clauses are given as one flat buffer of literals, in which each
+     *  clause is terminated by 0, as in the DIMACS format. The buffer is
+     *  checked and copied in a single pass, after reserving the required
+     *  space once. Either all clauses are added, or none.
+     *
+     *  Possible error codes:
+     *   -EINVAL ... a literal is greater than the maximal variable, or the
+     *               last clause is not terminated by 0
+     *   -ENOMEM ... the clauses could not be stored, or do not fit into the
+     *               formula anymore
+     *
+     *  @param literals flat buffer of 0-terminated clauses
+     *  @param size number of elements in literals, including the 0s
+     *  @param weights weight per clause, or 0 to add all clauses as hard
+     *         clauses
+     *
+     *  @return true, if all clauses have been added
+     */
+    bool addClauses(const int *literals, size_t size, const uint64_t *weights = 0)
+    {
+        if(size > 0 && literals[size - 1] != 0) {
+            errorCode = -EINVAL;
+            return false;
+        }
+
+        const size_t oldLiterals = clauseLiterals.size();
+        const size_t oldClauses = clauseStarts.size();
+        try {
+            const size_t clauses = std::count(literals, literals + size, 0);
+            size_t softClauses = 0;
+            for(size_t i = 0; weights && i < clauses; ++i) softClauses += weights[i] != 0;
+            if(!fits(oldLiterals, size + 2 * softClauses, clauses)) return false;
+            clauseLiterals.reserve(oldLiterals + size + 2 * softClauses);
+            clauseStarts.reserve(oldClauses + clauses);
+        } catch (std::exception &e) {
+            errorCode = -ENOMEM;
+            return false;
+        }
+
+        size_t clauseIndex = 0;
+        bool newClause = true;
+        for(size_t i = 0; i < size; ++i) {
+            const int literal = literals[i];
+            if(newClause) {
+                startClause(weights ? weights[clauseIndex] : 0);
+                newClause = false;
+            }
+            if(literal == 0) {
+                newClause = true;
+                ++clauseIndex;
+            } else if(std::abs((int64_t)literal) > maxVar) {
+                clauseLiterals.resize(oldLiterals);
+                clauseStarts.resize(oldClauses);
+                errorCode = -EINVAL;
+                return false;
+            }
+            clauseLiterals.push_back(literal);
+        }
+        errorCode = 0;
+        return true;
+    }
+
+    /** Select the encoding for at-most-k constraints without explicit
+     *  encoding, LIBRARY by default */
+    void setCardinalityEncoding(CardinalityEncoding encoding) { cardinalityEncoding = encoding; }
+
+    /** Add an at-most-k constraint, semantics as MaxSATSolver::addAtMostK */
+    bool addAtMostK(const std::vector<int> &literals, const unsigned k)
+    {
+        return addAtMostK(literals, k, cardinalityEncoding);
+    }
+
+    /** Add an at-most-k constraint with the given encoding
+     *
+     *  Semantics as MaxSATSolver::addAtMostK. Depending on the encoding, the
+     *  constraint is turned into hard clauses, which might introduce
+     *  auxiliary variables. If these clauses exceed the memory limit, none of
+     *  them is kept, and -ENOMEM is reported.
+     */
+    bool addAtMostK(const std::vector<int> &literals, const unsigned k, CardinalityEncoding encoding)
+    {
+        if(!validLiterals(literals.data(), literals.size())) return false;
+        errorCode = 0;
+
+        const size_t n = literals.size();
+        const bool direct = k == 0 || k + 1 >= n;
+        if(encoding == AUTOMATIC) encoding = direct || k == 1 ? (n <= 5 ? PAIRWISE : LADDER) : LIBRARY;
+        if(!direct && k != 1 && (encoding == PAIRWISE || encoding == LADDER)) encoding = LIBRARY;
+        // the backend drops at-most-0 constraints, hence always use units
+        if(encoding != LIBRARY || k == 0) {
+            const Checkpoint before = checkpoint();
+            encodeAtMostK(literals, k, encoding);
+            return encodedCompletely(before, encodingStatistics[encoding]);
+        }
+        if(!fits(amkLiterals.size(), literals.size() + 1)) return false;
+        amkStarts.push_back(amkLiterals.size());
+        amkLiterals.insert(amkLiterals.end(), literals.begin(), literals.end());
+        amkLiterals.push_back(0);
+        amkBounds.push_back(k);
+        encodingStatistics[LIBRARY].constraints++;
+        return true;
+    }
+
+    /** Add a pseudo-Boolean constraint sum(coefficients[i] * literals[i]) <= bound
+     *
+     *  The constraint is added as hard constraint. It is simplified first:
+     *  duplicate and complementary literals are merged, literals whose
+     *  coefficient exceeds the bound are set to false, and coefficients are
+     *  divided by their greatest common divisor. In case all remaining
+     *  coefficients are equal, the constraint is added as at-most-k
+     *  constraint. Otherwise, it is encoded into clauses via a reduced
+     *  decision diagram, which introduces auxiliary variables.
+     *
+     *  Possible error codes:
+     *   -EINVAL ... a literal is greater than the maximal variable, or 0, or
+     *               the number of literals and coefficients differs
+     *   -ENOMEM ... the encoding does not fit into the formula, in which case
+     *               no part of it is kept
+     *
+     *  @return true, if the constraint was added
+     */
+    bool addPB(const std::vector<int> &literals, const std::vector<uint64_t> &coefficients, uint64_t bound)
+    {
+        if(literals.size() != coefficients.size()) {
+            errorCode = -EINVAL;
+            return false;
+        }
+        if(!validLiterals(literals.data(), literals.size())) return false;
+        errorCode = 0;
+        const Checkpoint before = checkpoint();
+        EncodingStatistics &pbStatistics = encodingStatistics[SEQUENTIAL_COUNTER + 1];
+
+        // merge duplicate literals, and cancel complementary literals
+        std::map<int, std::pair<int64_t, int64_t> > byVariable;
+        int64_t rhs = bound > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)bound;
+        for(size_t i = 0; i < literals.size(); ++i) {
+            const int64_t c = coefficients[i] > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)coefficients[i];
+            std::pair<int64_t, int64_t> &entry = byVariable[std::abs((int64_t)literals[i])];
+            int64_t &sum = literals[i] > 0 ? entry.first : entry.second;
+            sum = sum > INT64_MAX - c ? INT64_MAX : sum + c;
+        }
+
+        std::vector<std::pair<int64_t, int> > terms;
+        for(std::map<int, std::pair<int64_t, int64_t> >::const_iterator it = byVariable.begin(); it != byVariable.end(); ++it) {
+            // a*x + b*~x = min(a,b) + (a-b)*x, if a > b
+            const int64_t positive = it->second.first, negative = it->second.second;
+            const int64_t common = std::min(positive, negative);
+            rhs = rhs < common ? -1 : rhs - common;
+            if(positive > negative) terms.push_back(std::make_pair(positive - negative, it->first));
+            else if(negative > positive) terms.push_back(std::make_pair(negative - positive, -it->first));
+        }
+        if(rhs < 0) {
+            const bool added = addClause(std::vector<int>());
+            return encodedCompletely(before, pbStatistics) && added;
+        }
+
+        // literals that exceed the bound on their own have to be false
+        std::vector<int> unit(1, 0);
+        int64_t total = 0, divisor = 0;
+        for(size_t i = 0; i < terms.size(); ) {
+            if(terms[i].first > rhs) {
+                unit[0] = -terms[i].second;
+                addClause(unit);
+                terms[i] = terms.back();
+                terms.pop_back();
+                continue;
+            }
+            total = saturatingAdd(total, terms[i].first);
+            int64_t a = divisor, b = terms[i].first;
+            while(b != 0) { const int64_t t = a % b; a = b; b = t; }
+            divisor = a;
+            ++i;
+        }
+        if(total <= rhs && total != INT64_MAX) return encodedCompletely(before, pbStatistics);
+
+        std::sort(terms.begin(), terms.end(), std::greater<std::pair<int64_t, int> >());
+        std::vector<int> pbLiterals(terms.size());
+        std::vector<int64_t> pbCoefficients(terms.size());
+        for(size_t i = 0; i < terms.size(); ++i) {
+            pbLiterals[i] = terms[i].second;
+            pbCoefficients[i] = terms[i].first / divisor;
+        }
+        rhs /= divisor;
+
+        // units for large coefficients are undone as well, if the rest fails
+        if(pbCoefficients.front() == pbCoefficients.back()) {
+            const bool added = addAtMostK(pbLiterals, rhs / pbCoefficients.front());
+            return encodedCompletely(before, pbStatistics) && added;
+        }
+
+        std::vector<int64_t> suffixSum(pbLiterals.size() + 1, 0);
+        for(size_t i = pbLiterals.size(); i > 0; --i) suffixSum[i - 1] = saturatingAdd(suffixSum[i], pbCoefficients[i - 1]);
+        std::vector<std::map<int64_t, PBNode> > nodes(pbLiterals.size());
+        const int root = encodePB(rhs, pbLiterals, pbCoefficients, suffixSum, nodes);
+        bool added = true;
+        if(root == pbFalse) added = addClause(std::vector<int>());
+        else if(root != pbTrue) {
+            unit[0] = root;
+            added = addClause(unit);
+        }
+        return encodedCompletely(before, pbStatistics) && added;
+    }
+
+    /** Number of stored clauses, hard and soft */
+    size_t nClauses() const { return clauseStarts.size(); }
+
+    /** Literals of clause i, terminated by 0 */
+    const int *clause(size_t i) const { return &clauseLiterals[literalStart(i)]; }
+
+    /** Number of literals of clause i */
+    size_t clauseSize(size_t i) const
+    {
+        if(i + 1 == clauseStarts.size()) return clauseLiterals.size() - literalStart(i) - 1;
+        // the weight of a soft clause follows the 0 of the previous clause
+        const size_t end = literalStart(i + 1) - ((clauseStarts[i + 1] & softFlag) ? 2 : 0);
+        return end - literalStart(i) - 1;
+    }
+
+    /** Weight of clause i, 0 for hard clauses */
+    uint64_t weight(size_t i) const
+    {
+        if(!(clauseStarts[i] & softFlag)) return 0;
+        uint64_t weight = 0;
+        memcpy(&weight, &clauseLiterals[literalStart(i) - 2], sizeof(weight));
+        return weight;
+    }
+
+    /** Number of stored at-most-k constraints */
+    size_t nAtMostK() const { return amkStarts.size(); }
+
+    /** Literals of at-most-k constraint i, terminated by 0 */
+    const int *atMostK(size_t i) const { return &amkLiterals[amkStarts[i]]; }
+
+    /** Number of literals of at-most-k constraint i */
+    size_t atMostKSize(size_t i) const
+    {
+        const size_t end = i + 1 < amkStarts.size() ? amkStarts[i + 1] : amkLiterals.size();
+        return end - amkStarts[i] - 1;
+    }
+
+    /** Bound k of at-most-k constraint i */
+    unsigned atMostKBound(size_t i) const { return amkBounds[i]; }
+
+    /** Store the formula in a compact binary format
+     *
+     *  The format contains the buffers of the formula as they are stored in
+     *  memory, together with the variables, the default encoding, and the
+     *  encoding statistics. Cardinality and pseudo-Boolean constraints that
+     *  have been encoded into clauses are stored with their encoding. Hence,
+     *  deserialize only copies the buffers, and does not encode again. The
+     *  format depends on the byte order of the machine.
+     *
+     *  @return false, if the buffer cannot be allocated
+     */
+    bool serialize(std::vector<char> &buffer) const
+    {
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "SMAXSNAP", 8);
+        header.version = 1;
+        header.byteOrder = 0x01020304;
+        header.maxVar = maxVar;
+        header.cardinalityEncoding = cardinalityEncoding;
+        header.sizes[0] = clauseLiterals.size();
+        header.sizes[1] = clauseStarts.size();
+        header.sizes[2] = amkLiterals.size();
+        header.sizes[3] = amkStarts.size();
+        header.sizes[4] = amkBounds.size();
+        for(int e = 0; e < SEQUENTIAL_COUNTER + 2; ++e) {
+            header.statistics[3 * e] = encodingStatistics[e].constraints;
+            header.statistics[3 * e + 1] = encodingStatistics[e].clauses;
+            header.statistics[3 * e + 2] = encodingStatistics[e].variables;
+        }
+
+        size_t bytes = sizeof(header);
+        for(int i = 0; i < 5; ++i) bytes += paddedBytes(header.sizes[i]);
+        try {
+            buffer.assign(bytes, 0);
+        } catch (std::exception &e) {
+            return false;
+        }
+        char *pos = buffer.data();
+        memcpy(pos, &header, sizeof(header));
+        pos += sizeof(header);
+        writeSection(pos, clauseLiterals);
+        writeSection(pos, clauseStarts);
+        writeSection(pos, amkLiterals);
+        writeSection(pos, amkStarts);
+        writeSection(pos, amkBounds);
+        return true;
+    }
+
+    /** Replace the formula by a formula in the format of serialize
+     *
+     *  The data is checked to form a valid formula, which is linear in its
+     *  size, and does not have to be aligned.
+     *
+     *  Possible error codes:
+     *   -EINVAL ... the data is not a valid formula in the binary format
+     *   -ENOMEM ... the formula exceeds the memory limit, or cannot be stored
+     *
+     *  @return true, if the formula has been replaced, otherwise the formula
+     *          is empty
+     */
+    bool deserialize(const char *data, size_t size)
+    {
+        clear();
+        SnapshotHeader header;
+        if(size < sizeof(header)) {
+            errorCode = -EINVAL;
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        size_t bytes = sizeof(header);
+        bool valid = memcmp(header.magic, "SMAXSNAP", 8) == 0 && header.version == 1 &&
+                     header.byteOrder == 0x01020304 && header.maxVar >= 0 &&
+                     header.cardinalityEncoding >= LIBRARY && header.cardinalityEncoding <= SEQUENTIAL_COUNTER;
+        for(int i = 0; valid && i < 5; ++i) {
+            valid = header.sizes[i] < softFlag;
+            bytes += valid ? paddedBytes(header.sizes[i]) : 0;
+        }
+        if(!valid || bytes != size) {
+            errorCode = -EINVAL;
+            return false;
+        }
+        const size_t stored = (header.sizes[0] + header.sizes[1] + header.sizes[2] + header.sizes[3] + header.sizes[4]) * sizeof(int);
+        if(memoryLimit != 0 && stored > memoryLimit) {
+            errorCode = -ENOMEM;
+            return false;
+        }
+
+        try {
+            const char *pos = data + sizeof(header);
+            readSection(pos, clauseLiterals, header.sizes[0]);
+            readSection(pos, clauseStarts, header.sizes[1]);
+            readSection(pos, amkLiterals, header.sizes[2]);
+            readSection(pos, amkStarts, header.sizes[3]);
+            readSection(pos, amkBounds, header.sizes[4]);
+        } catch (std::exception &e) {
+            clear();
+            errorCode = -ENOMEM;
+            return false;
+        }
+        const int previousVars = maxVar;
+        maxVar = header.maxVar;
+        if(!validSnapshot()) {
+            clear(previousVars);
+            errorCode = -EINVAL;
+            return false;
+        }
+        cardinalityEncoding = (CardinalityEncoding)header.cardinalityEncoding;
+        for(int e = 0; e < SEQUENTIAL_COUNTER + 2; ++e) {
+            encodingStatistics[e].constraints = header.statistics[3 * e];
+            encodingStatistics[e].clauses = header.statistics[3 * e + 1];
+            encodingStatistics[e].variables = header.statistics[3 * e + 2];
+        }
+        errorCode = 0;
+        return true;
+    }
+
+    /** Number of bytes allocated to store the formula */
+    size_t memoryUsage() const
+    {
+        return clauseLiterals.capacity() * sizeof(int) + clauseStarts.capacity() * sizeof(uint32_t) +
+               amkLiterals.capacity() * sizeof(int) + amkStarts.capacity() * sizeof(uint32_t) +
+               amkBounds.capacity() * sizeof(unsigned);
+    }
+
+    /** Statistics of the at-most-k constraints that have been added with the
+     *  given encoding, after AUTOMATIC selected an encoding. Constraints of
+     *  LIBRARY that are stored for the backend do not add clauses. */
+    const EncodingStatistics &getEncodingStatistics(CardinalityEncoding encoding) const
+    {
+        return encodingStatistics[encoding];
+    }
+
+    /** Statistics of the pseudo-Boolean constraints, see addPB. Constraints
+     *  that are added as at-most-k constraints are part of the statistics
+     *  of their encoding as well. */
+    const EncodingStatistics &getPBStatistics() const { return encodingStatistics[SEQUENTIAL_COUNTER + 1]; }
+
+    /** Limit the memory of the stored clauses and constraints
+     *
+     *  Additions that would exceed the given number of bytes fail with
+     *  -ENOMEM, instead of allocating more memory. Only the stored data is
+     *  accounted, such that memoryUsage can be higher by the unused capacity
+     *  of the buffers. The value 0, the default, disables the limit.
+     */
+    void setMemoryLimit(size_t bytes) { memoryLimit = bytes; }
+
+    /** Memory limit of the formula, 0 if there is no limit */
+    size_t getMemoryLimit() const { return memoryLimit; }
+
+    /** Check whether the formula contains neither clauses nor constraints */
+    bool empty() const { return clauseStarts.empty() && amkStarts.empty(); }
+
+    /** Remove all clauses and constraints, and their statistics, but keep the
+     *  allocated memory */
+    void clear()
+    {
+        errorCode = 0;
+        clauseLiterals.clear();
+        clauseStarts.clear();
+        amkLiterals.clear();
+        amkStarts.clear();
+        amkBounds.clear();
+        std::fill(encodingStatistics, encodingStatistics + SEQUENTIAL_COUNTER + 2, EncodingStatistics());
+    }
+
+    /** Remove all clauses and constraints, and use the variables 1 to nVars
+     *  from now on, but keep the allocated memory */
+    void clear(int nVars)
+    {
+        clear();
+        maxVar = nVars < 0 ? 0 : nVars;
+    }
+
+    /** Check whether a literal is satisfied by a model in the format of
+     *  MaxSATSolver::compute_maxsat. Unassigned variables are treated as false.
+     */
+    static bool isTrue(const std::vector<int> &model, int literal)
+    {
+        const size_t v = std::abs((int64_t)literal);
+        const bool value = v < model.size() && model[v] > 0;
+        return literal > 0 ? value : !value;
+    }
+
+    /** Create a model for all variables of the formula, in the format of
+     *  MaxSATSolver::compute_maxsat
+     *
+     *  @param model stores the model
+     *  @param assignment values to be used, unassigned variables are false
+     */
+    void makeModel(std::vector<int> &model, const std::vector<int> *assignment = 0) const
+    {
+        model.assign(maxVar + 1, 0);
+        for(int v = 1; v <= maxVar; ++v)
+            model[v] = assignment && isTrue(*assignment, v) ? v : -v;
+    }
+
+    /** Check whether clause i is satisfied by the given model */
+    bool satisfiesClause(const std::vector<int> &model, size_t i) const
+    {
+        for(const int *lit = clause(i); *lit != 0; ++lit)
+            if(isTrue(model, *lit)) return true;
+        return false;
+    }
+
+    /** Check whether at-most-k constraint i is satisfied by the given model */
+    bool satisfiesAtMostK(const std::vector<int> &model, size_t i) const
+    {
+        unsigned count = 0;
+        for(const int *lit = atMostK(i); *lit != 0; ++lit)
+            if(isTrue(model, *lit) && ++count > amkBounds[i]) return false;
+        return true;
+    }
+
+    /** Compute the cost of a model for the clauses and constraints starting
+     *  at the given positions
+     *
+     *  @param model assignment in the format of MaxSATSolver::compute_maxsat
+     *  @param cost stores the sum of the weights of falsified soft clauses
+     *  @param firstClause first clause to consider
+     *  @param firstAtMostK first at-most-k constraint to consider
+     *
+     *  @return true, if the model satisfies all considered hard clauses and
+     *          at-most-k constraints
+     */
+    bool computeCost(const std::vector<int> &model, uint64_t &cost,
+                     size_t firstClause = 0, size_t firstAtMostK = 0) const
+    {
+        cost = 0;
+        bool hardSatisfied = true;
+        for(size_t i = firstClause; i < nClauses(); ++i) {
+            if(satisfiesClause(model, i)) continue;
+            const uint64_t w = weight(i);
+            if(w == 0) hardSatisfied = false;
+            else cost += w;
+        }
+        for(size_t i = firstAtMostK; hardSatisfied && i < nAtMostK(); ++i)
+            hardSatisfied = satisfiesAtMostK(model, i);
+        return hardSatisfied;
+    }
+
+    /** Add all clauses and constraints of this formula to the given solver
+     *
+     *  @param solver solver to receive the formula
+     *  @param withSoftClauses if false, only hard clauses and constraints are
+     *         added, e.g. to check whether the hard part is satisfiable
+     *  @param seed if not 0, the clauses are added in a random order that
+     *         depends on this seed, to diversify the search of the solver
+     *
+     *  @return true, if all elements could be added. Otherwise, false is
+     *          returned, and the error code can be taken from the solver.
+     */
+    bool loadInto(MaxSATSolver &solver, bool withSoftClauses = true, unsigned seed = 0) const
+    {
+        std::vector<size_t> order;
+        if(seed != 0) {
+            order.resize(nClauses());
+            for(size_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::mt19937 rng(seed);
+            std::shuffle(order.begin(), order.end(), rng);
+        }
+
+        std::vector<int> literals;
+        for(size_t j = 0; j < nClauses(); ++j) {
+            const size_t i = seed != 0 ? order[j] : j;
+            if(!withSoftClauses && weight(i) != 0) continue;
+            literals.assign(clause(i), clause(i) + clauseSize(i));
+            if(!solver.addClause(literals, weight(i))) return false;
+        }
+        for(size_t i = 0; i < nAtMostK(); ++i) {
+            literals.assign(atMostK(i), atMostK(i) + atMostKSize(i));
+            if(!solver.addAtMostK(literals, amkBounds[i])) return false;
+        }
+        return true;
+    }
+
+    /** Split the formula into parts that do not share variables
+     *
+     *  Parts without common variables can be solved independently, and the
+     *  cost of the formula is the sum of the costs of the parts. Each part
+     *  uses the variables 1 to n, and variables[p][i] stores the variable of
+     *  this formula that is represented by variable i of part p. Variables
+     *  that do not occur in the formula are not part of any component.
+     *
+     *  @param components stores the parts of the formula
+     *  @param variables stores the variable mapping of each part
+     */
+    void splitComponents(std::vector<MaxSATInstance> &components,
+                         std::vector<std::vector<int> > &variables) const
+    {
+        // union find over variables, linking all variables of a constraint
+        std::vector<int> parent(maxVar + 1);
+        for(int v = 0; v <= maxVar; ++v) parent[v] = v;
+        std::vector<bool> used(maxVar + 1, false);
+        for(size_t i = 0; i < nClauses() + nAtMostK(); ++i) {
+            int first = 0;
+            for(const int *lit = i < nClauses() ? clause(i) : atMostK(i - nClauses()); *lit != 0; ++lit) {
+                const int v = std::abs((int64_t)*lit);
+                used[v] = true;
+                if(first == 0) first = v;
+                else parent[findRoot(parent, v)] = findRoot(parent, first);
+            }
+        }
+
+        // assign each used variable to its part, and renumber it
+        std::vector<int> componentOf(maxVar + 1, -1), renamed(maxVar + 1, 0);
+        components.clear();
+        variables.clear();
+        for(int v = 1; v <= maxVar; ++v) {
+            if(!used[v]) continue;
+            const int root = findRoot(parent, v);
+            if(componentOf[root] == -1) {
+                componentOf[root] = variables.size();
+                variables.push_back(std::vector<int>(1, 0));
+            }
+            std::vector<int> &mapping = variables[componentOf[root]];
+            renamed[v] = mapping.size();
+            mapping.push_back(v);
+        }
+        for(size_t p = 0; p < variables.size(); ++p) {
+            variables[p].erase(variables[p].begin());
+            components.push_back(MaxSATInstance(variables[p].size()));
+        }
+
+        std::vector<int> literals;
+        for(size_t i = 0; i < nClauses(); ++i) {
+            literals.clear();
+            int part = -1;
+            for(const int *lit = clause(i); *lit != 0; ++lit) {
+                const int v = std::abs((int64_t)*lit);
+                part = componentOf[findRoot(parent, v)];
+                literals.push_back(*lit > 0 ? renamed[v] : -renamed[v]);
+            }
+            // empty clauses cannot be assigned to a part, keep them in the first
+            if(part == -1) {
+                if(components.empty()) {
+                    components.push_back(MaxSATInstance(0));
+                    variables.push_back(std::vector<int>());
+                }
+                part = 0;
+            }
+            components[part].addClause(literals, weight(i));
+        }
+        for(size_t i = 0; i < nAtMostK(); ++i) {
+            literals.clear();
+            int part = -1;
+            for(const int *lit = atMostK(i); *lit != 0; ++lit) {
+                const int v = std::abs((int64_t)*lit);
+                part = componentOf[findRoot(parent, v)];
+                literals.push_back(*lit > 0 ? renamed[v] : -renamed[v]);
+            }
+            if(part != -1) components[part].addAtMostK(literals, amkBounds[i]);
+        }
+    }
+};
+
+#endif
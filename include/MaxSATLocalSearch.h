@@ -0,0 +1,373 @@
+/**********************************************************************************[MaxSATLocalSearch.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATLocalSearch_Interface_h
+#define MaxSATLocalSearch_Interface_h
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <random>
+#include <vector>
+
+#include "MaxSATInstance.h"
+
+/** Class to find good models of a MaxSAT formula by stochastic local search
+ *
+ *  The search follows the dynamic clause weighting scheme of SATLike: each
+ *  hard clause and at-most-k constraint carries a dynamic weight, that starts
+ *  at 1 and is increased whenever the search is stuck while the constraint
+ *  is violated. Soft clauses carry a dynamic weight as well, that is bounded
+ *  relative to their original weight, and only increased when all hard
+ *  constraints are satisfied. As the search only inspects a single soft
+ *  clause per step, only the weight of this clause is increased. In each
+ *  step, a violated constraint is picked, preferring hard ones, and the
+ *  variable of this constraint with the best score is flipped, where the
+ *  score is the change of the sum of dynamic weights of violated
+ *  constraints. Ties are broken by picking the variable that has not been
+ *  flipped for the longest time.
+ *
+ *  Constraints and occurrence lists are stored in flat arrays, and the
+ *  number of true literals per constraint is maintained incrementally, so
+ *  that a flip only touches the constraints of the flipped variable.
+ *
+ *  The best model that satisfies all hard constraints is kept, and can be
+ *  used as start assignment, and its cost as upper bound, for the backend.
+ */
+class MaxSATLocalSearch {
+
+    /** number of variables */
+    int nVars;
+
+    /** error code of the last failed call */
+    int errorCode;
+
+    /** literals of all constraints, constraint c uses the range
+     *  [starts[c], starts[c+1]) */
+    std::vector<int> literals;
+    std::vector<size_t> starts;
+
+    /** bound of at-most-k constraints, -1 for clauses */
+    std::vector<int64_t> bounds;
+
+    /** original weight of each constraint, 0 for hard constraints */
+    std::vector<uint64_t> weights;
+
+    /** upper limit for the dynamic weight of soft clauses */
+    std::vector<uint64_t> weightLimits;
+
+    /** cost of soft clauses that cannot be satisfied */
+    uint64_t fixedCost;
+
+    /** whether the formula contains an empty hard clause */
+    bool trivialConflict;
+
+    /** constraints per literal, literal l uses the range
+     *  [occStarts[index(l)], occStarts[index(l)+1]) */
+    std::vector<uint32_t> occurrences;
+    std::vector<size_t> occStarts;
+
+    /** state of the search */
+    std::vector<char> values;
+    std::vector<char> frozen;
+    std::vector<uint64_t> lastFlip;
+    std::vector<int64_t> trueCount;
+    std::vector<uint64_t> dynamicWeights;
+
+    /** violated hard and soft constraints, with the position of each
+     *  constraint in its list, or -1 */
+    std::vector<uint32_t> violatedHard, violatedSoft;
+    std::vector<int64_t> violatedPosition;
+
+    /** cost of the current assignment */
+    uint64_t currentCost;
+
+    /** best model that satisfies all hard constraints, and its cost */
+    std::vector<int> bestModel;
+    uint64_t bestCost;
+
+    /** number of flips of the last search */
+    uint64_t flips;
+
+    std::mt19937 rng;
+
+    /** Explicitly disallow copy constructors */
+    MaxSATLocalSearch(const MaxSATLocalSearch& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    MaxSATLocalSearch& operator=(MaxSATLocalSearch const&) = delete;
+
+    /** Index of a literal in occurrence lists */
+    static size_t index(int literal) { return 2 * (size_t)std::abs((int64_t)literal) + (literal < 0); }
+
+    bool isTrue(int literal) const { return values[std::abs((int64_t)literal)] == (literal > 0); }
+
+    bool isViolated(uint32_t c) const
+    {
+        return bounds[c] < 0 ? trueCount[c] == 0 : trueCount[c] > bounds[c];
+    }
+
+    /** Add or remove a constraint from the lists of violated constraints */
+    void updateViolation(uint32_t c)
+    {
+        const bool violated = isViolated(c);
+        if(violated == (violatedPosition[c] >= 0)) return;
+        std::vector<uint32_t> &list = weights[c] == 0 ? violatedHard : violatedSoft;
+        if(violated) {
+            violatedPosition[c] = list.size();
+            list.push_back(c);
+            currentCost += weights[c];
+        } else {
+            const uint32_t last = list.back();
+            list[violatedPosition[c]] = last;
+            violatedPosition[last] = violatedPosition[c];
+            list.pop_back();
+            violatedPosition[c] = -1;
+            currentCost -= weights[c];
+        }
+    }
+
+    /** Change of the dynamic weight of violated constraints when flipping v,
+     *  positive values are improvements */
+    int64_t score(int v) const
+    {
+        const int becomesFalse = values[v] ? v : -v;
+        int64_t ret = 0;
+        for(size_t i = occStarts[index(becomesFalse)]; i < occStarts[index(becomesFalse) + 1]; ++i) {
+            const uint32_t c = occurrences[i];
+            if(bounds[c] < 0) {
+                if(trueCount[c] == 1) ret -= dynamicWeights[c];
+            } else if(trueCount[c] > bounds[c]) ret += dynamicWeights[c];
+        }
+        const int becomesTrue = -becomesFalse;
+        for(size_t i = occStarts[index(becomesTrue)]; i < occStarts[index(becomesTrue) + 1]; ++i) {
+            const uint32_t c = occurrences[i];
+            if(bounds[c] < 0) {
+                if(trueCount[c] == 0) ret += dynamicWeights[c];
+            } else if(trueCount[c] >= bounds[c]) ret -= dynamicWeights[c];
+        }
+        return ret;
+    }
+
+    /** Flip variable v, and update counters and violated constraints */
+    void flip(int v)
+    {
+        values[v] = !values[v];
+        lastFlip[v] = ++flips;
+        const int becomesTrue = values[v] ? v : -v;
+        for(size_t i = occStarts[index(becomesTrue)]; i < occStarts[index(becomesTrue) + 1]; ++i) {
+            trueCount[occurrences[i]]++;
+            updateViolation(occurrences[i]);
+        }
+        for(size_t i = occStarts[index(-becomesTrue)]; i < occStarts[index(-becomesTrue) + 1]; ++i) {
+            trueCount[occurrences[i]]--;
+            updateViolation(occurrences[i]);
+        }
+    }
+
+    /** Increase the dynamic weight of violated hard constraints, or of the
+     *  picked soft clause, if all hard constraints are satisfied */
+    void updateWeights(uint32_t picked)
+    {
+        for(size_t i = 0; i < violatedHard.size(); ++i) dynamicWeights[violatedHard[i]]++;
+        if(violatedHard.empty() && dynamicWeights[picked] < weightLimits[picked]) dynamicWeights[picked]++;
+    }
+
+    /** Store the current assignment as best model */
+    void saveModel()
+    {
+        bestCost = currentCost + fixedCost;
+        bestModel.assign(nVars + 1, 0);
+        for(int v = 1; v <= nVars; ++v) bestModel[v] = values[v] ? v : -v;
+    }
+
+public:
+
+    /** Prepare the search on a copy of the given formula
+     *
+     *  Possible error codes:
+     *   -ENOMEM ... the formula could not be stored
+     */
+    MaxSATLocalSearch(const MaxSATInstance &formula, unsigned seed = 0)
+    : nVars(formula.nVars())
+    , errorCode(0)
+    , fixedCost(0)
+    , trivialConflict(false)
+    , currentCost(0)
+    , bestCost(UINT64_MAX)
+    , flips(0)
+    , rng(seed)
+    {
+        try {
+            uint64_t maxWeight = 1;
+            std::vector<int> clause;
+            starts.push_back(0);
+            for(size_t i = 0; i < formula.nClauses(); ++i) {
+                clause.assign(formula.clause(i), formula.clause(i) + formula.clauseSize(i));
+                std::sort(clause.begin(), clause.end());
+                clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+                bool tautology = false;
+                for(size_t j = 0; j + 1 < clause.size(); ++j)
+                    if(std::binary_search(clause.begin() + j + 1, clause.end(), -clause[j])) tautology = true;
+                if(tautology) continue;
+                if(clause.empty()) {
+                    if(formula.weight(i) == 0) trivialConflict = true;
+                    fixedCost += formula.weight(i);
+                    continue;
+                }
+                literals.insert(literals.end(), clause.begin(), clause.end());
+                starts.push_back(literals.size());
+                bounds.push_back(-1);
+                weights.push_back(formula.weight(i));
+                maxWeight = std::max(maxWeight, formula.weight(i));
+            }
+            for(size_t i = 0; i < formula.nAtMostK(); ++i) {
+                literals.insert(literals.end(), formula.atMostK(i), formula.atMostK(i) + formula.atMostKSize(i));
+                starts.push_back(literals.size());
+                bounds.push_back(formula.atMostKBound(i));
+                weights.push_back(0);
+            }
+            if(weights.size() > UINT32_MAX) {
+                errorCode = -ENOMEM;
+                return;
+            }
+
+            // soft clauses may weigh up to 100 times as much as violated hard ones initially
+            weightLimits.resize(weights.size(), 0);
+            for(size_t c = 0; c < weights.size(); ++c)
+                weightLimits[c] = weights[c] == 0 ? UINT64_MAX : 1 + (uint64_t)(100.0 * weights[c] / maxWeight);
+
+            occStarts.assign(2 * (size_t)nVars + 3, 0);
+            for(size_t i = 0; i < literals.size(); ++i) occStarts[index(literals[i]) + 1]++;
+            for(size_t i = 1; i < occStarts.size(); ++i) occStarts[i] += occStarts[i - 1];
+            occurrences.resize(literals.size());
+            std::vector<size_t> fill(occStarts.begin(), occStarts.end() - 1);
+            for(uint32_t c = 0; c + 1 < starts.size(); ++c)
+                for(size_t i = starts[c]; i < starts[c + 1]; ++i) occurrences[fill[index(literals[i])]++] = c;
+        } catch (std::exception &e) {
+            errorCode = -ENOMEM;
+        }
+    }
+
+    /** Return error code of the last failed call, or 0 */
+    int getErrno() const { return errorCode; }
+
+    /** Search for a model with low cost
+     *
+     *  The search starts from the given start assignment, where variables
+     *  that are not assigned by it start with a random value. The search
+     *  stops after the given number of flips, when the time limit is
+     *  reached, or when a model without cost is found.
+     *
+     *  @param maxFlips maximal number of flips
+     *  @param startAssignment initial assignment, see MaxSATSolver::compute_maxsat
+     *  @param assumptions literals that are never flipped, if not 0
+     *  @param milliseconds time limit, a negative value disables the limit
+     *
+     *  @return true, if a model that satisfies all hard constraints was found
+     */
+    bool search(uint64_t maxFlips, const std::vector<int> *startAssignment = 0,
+                const std::vector<int> *assumptions = 0, int64_t milliseconds = -1)
+    {
+        bestModel.clear();
+        bestCost = UINT64_MAX;
+        flips = 0;
+        if(errorCode != 0 || trivialConflict) return false;
+
+        const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds < 0 ? 0 : milliseconds);
+        try {
+            values.assign(nVars + 1, 0);
+            frozen.assign(nVars + 1, 0);
+            lastFlip.assign(nVars + 1, 0);
+            for(int v = 1; v <= nVars; ++v) {
+                if(startAssignment && v < (int)startAssignment->size() && (*startAssignment)[v] != 0)
+                    values[v] = MaxSATInstance::isTrue(*startAssignment, v);
+                else
+                    values[v] = rng() & 1;
+            }
+            for(size_t i = 0; assumptions && i < assumptions->size(); ++i) {
+                const int l = (*assumptions)[i];
+                if(l == 0 || std::abs((int64_t)l) > nVars) continue;
+                values[std::abs((int64_t)l)] = l > 0;
+                frozen[std::abs((int64_t)l)] = 1;
+            }
+
+            const size_t nConstraints = weights.size();
+            trueCount.assign(nConstraints, 0);
+            dynamicWeights.assign(nConstraints, 1);
+            violatedPosition.assign(nConstraints, -1);
+            violatedHard.clear();
+            violatedSoft.clear();
+            currentCost = 0;
+            for(uint32_t c = 0; c < nConstraints; ++c) {
+                for(size_t i = starts[c]; i < starts[c + 1]; ++i) trueCount[c] += isTrue(literals[i]);
+                updateViolation(c);
+            }
+        } catch (std::exception &e) {
+            errorCode = -ENOMEM;
+            return false;
+        }
+
+        std::vector<int> candidates;
+        while(true) {
+            if(violatedHard.empty() && currentCost + fixedCost < bestCost) {
+                saveModel();
+                if(currentCost == 0) break;
+            }
+            if(flips >= maxFlips || (violatedHard.empty() && violatedSoft.empty())) break;
+            if(milliseconds >= 0 && (flips & 255) == 0 && std::chrono::steady_clock::now() >= deadline) break;
+
+            // focus on a violated constraint, hard ones first
+            const std::vector<uint32_t> &violated = violatedHard.empty() ? violatedSoft : violatedHard;
+            const uint32_t c = violated[rng() % violated.size()];
+            candidates.clear();
+            for(size_t i = starts[c]; i < starts[c + 1]; ++i) {
+                const int v = std::abs((int64_t)literals[i]);
+                // at-most-k constraints are repaired by falsifying true literals
+                if(!frozen[v] && (bounds[c] < 0 || isTrue(literals[i]))) candidates.push_back(v);
+            }
+            if(candidates.empty()) {
+                // only assumptions can repair this constraint
+                updateWeights(c);
+                ++flips;
+                continue;
+            }
+
+            int best = candidates[0];
+            int64_t bestScore = score(best);
+            for(size_t i = 1; i < candidates.size(); ++i) {
+                const int64_t s = score(candidates[i]);
+                if(s > bestScore || (s == bestScore && lastFlip[candidates[i]] < lastFlip[best])) {
+                    best = candidates[i];
+                    bestScore = s;
+                }
+            }
+            if(bestScore <= 0) {
+                updateWeights(c);
+                // random walk with a small probability
+                if(rng() % 100 == 0) best = candidates[rng() % candidates.size()];
+            }
+            flip(best);
+        }
+        return !bestModel.empty();
+    }
+
+    /** Best model of the last search, in the format of
+     *  MaxSATSolver::compute_maxsat, or empty */
+    const std::vector<int> &getModel() const { return bestModel; }
+
+    /** Cost of the best model of the last search, UINT64_MAX if none */
+    uint64_t getCost() const { return bestCost; }
+
+    /** Number of flips of the last search */
+    uint64_t getFlips() const { return flips; }
+};
+
+#endif
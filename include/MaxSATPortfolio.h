@@ -0,0 +1,449 @@
+/**********************************************************************************[MaxSATPortfolio.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATPortfolio_Interface_h
+#define MaxSATPortfolio_Interface_h
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "MaxSATInstance.h"
+#include "MaxSATSolver.h"
+
+/** Class to solve a MaxSAT formula with several diversified solvers in parallel
+ *
+ *  Each worker thread loads a shared, read-only copy of the formula into its
+ *  own MaxSATSolver backend. Workers differ in the order in which clauses are
+ *  handed to the backend, and in the start assignment of the search. The
+ *  first worker that proves its result (OPTIMAL or UNSATISFIABLE) determines
+ *  the result of the call. If no worker can prove its result, the model with
+ *  the least cost is reported.
+ *
+ *  Alternatively, the workers can split the work of a single formula, by
+ *  solving the parts of the formula that do not share variables in parallel,
+ *  or solve a batch of independent formulas.
+ *
+ *  Note: the backend cannot be interrupted. Hence, workers that did not finish
+ *  first keep running after compute_maxsat returned, and their results are
+ *  dropped. Later calls do not wait for them, they only clean up workers that
+ *  finished in the meantime. The destructor waits for all workers.
+ */
+class MaxSATPortfolio {
+
+public:
+
+    /** Result of a single formula of a batch, see compute_maxsat_batch */
+    struct BatchResult {
+        MaxSATSolver::ReturnCode status;
+        std::vector<int> model;
+        uint64_t cost;
+        int errorCode;
+
+        BatchResult() : status(MaxSATSolver::UNKNOWN), cost(UINT64_MAX), errorCode(0) {}
+    };
+
+private:
+
+    /** State of a single call, shared between the caller and all workers */
+    struct SharedState {
+        std::mutex lock;
+        std::condition_variable finished;
+
+        /** formula to be solved, not modified by the workers */
+        std::shared_ptr<const MaxSATInstance> formula;
+
+        /** number of workers that still have to report their result */
+        unsigned running;
+
+        /** status, model, and cost of the best result so far */
+        MaxSATSolver::ReturnCode status;
+        std::vector<int> model;
+        uint64_t cost;
+
+        /** whether a worker failed, and the error code of the failure */
+        bool failed;
+        int errorCode;
+
+        SharedState() : running(0), status(MaxSATSolver::UNKNOWN), cost(UINT64_MAX), failed(false), errorCode(0) {}
+    };
+
+    /** number of workers to start per call */
+    unsigned nThreads;
+
+    /** error code of the last failed call, see MaxSATSolver::getErrno */
+    int errorCode;
+
+    /** worker thread, with the state of the call it reports to */
+    struct Worker {
+        std::thread thread;
+        std::shared_ptr<SharedState> state;
+    };
+
+    /** workers of previous calls, that might still be running */
+    std::vector<Worker> workers;
+
+    /** Explicitly disallow copy constructors */
+    MaxSATPortfolio(const MaxSATPortfolio& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    MaxSATPortfolio& operator=(MaxSATPortfolio const&) = delete;
+
+    /** Check whether a status cannot be improved by other workers */
+    static bool isFinal(MaxSATSolver::ReturnCode status)
+    {
+        return status == MaxSATSolver::OPTIMAL || status == MaxSATSolver::UNSATISFIABLE;
+    }
+
+    /** Run a single configuration, and merge its result into the shared state
+     *
+     *  Worker 0 uses the formula as given. All other workers shuffle the
+     *  clauses. Workers with an even number start from a random assignment,
+     *  all others from the given start assignment.
+     */
+    static void work(std::shared_ptr<SharedState> state, unsigned worker,
+                     std::shared_ptr<const std::vector<int> > startAssignment,
+                     uint64_t maxCost, int64_t maxMinimizeSteps)
+    {
+        const MaxSATInstance &formula = *state->formula;
+
+        std::vector<int> randomStart;
+        const std::vector<int> *start = startAssignment.get();
+        if(worker != 0 && worker % 2 == 0) {
+            std::mt19937 rng(worker);
+            randomStart.resize(formula.nVars() + 1, 0);
+            for(int v = 1; v <= formula.nVars(); ++v) randomStart[v] = (rng() & 1) ? v : -v;
+            start = &randomStart;
+        }
+
+        std::vector<int> model;
+        uint64_t cost = UINT64_MAX;
+        MaxSATSolver::ReturnCode ret = MaxSATSolver::ERROR;
+        int errorCode = 0;
+        {
+            MaxSATSolver solver(formula.nVars(), formula.nClauses());
+            if(solver.getErrno() == 0 && formula.loadInto(solver, true, worker))
+                ret = solver.compute_maxsat(model, cost, maxCost, start, maxMinimizeSteps);
+            errorCode = solver.getErrno();
+        }
+
+        std::unique_lock<std::mutex> guard(state->lock);
+        if(!isFinal(state->status)) {
+            const bool hasModel = ret == MaxSATSolver::OPTIMAL || ret == MaxSATSolver::SATISFIABLE;
+            if(isFinal(ret) || (hasModel && (state->model.empty() || cost < state->cost))) {
+                state->status = ret;
+                state->model.swap(model);
+                state->cost = cost;
+            } else if(ret == MaxSATSolver::ERROR) {
+                state->failed = true;
+                state->errorCode = errorCode;
+            }
+        }
+        state->running--;
+        state->finished.notify_all();
+    }
+
+    /** Solve a single formula of a batch with a fresh backend */
+    static void solveSingle(const MaxSATInstance &formula, BatchResult &result,
+                            uint64_t maxCost, int64_t maxMinimizeSteps)
+    {
+        result.model.clear();
+        result.cost = UINT64_MAX;
+        result.errorCode = 0;
+        // the backend does not accept empty formulas
+        if(formula.empty()) {
+            formula.makeModel(result.model);
+            result.cost = 0;
+            result.status = MaxSATSolver::OPTIMAL;
+            return;
+        }
+        MaxSATSolver solver(formula.nVars(), formula.nClauses());
+        if(solver.getErrno() == 0 && formula.loadInto(solver))
+            result.status = solver.compute_maxsat(result.model, result.cost, maxCost, 0, maxMinimizeSteps);
+        else
+            result.status = MaxSATSolver::ERROR;
+        result.errorCode = solver.getErrno();
+    }
+
+    /** Join the workers of calls, for which all workers reported their
+     *  result, and keep all others running */
+    void reap()
+    {
+        size_t kept = 0;
+        for(size_t i = 0; i < workers.size(); ++i) {
+            bool done = false;
+            {
+                std::unique_lock<std::mutex> guard(workers[i].state->lock);
+                done = workers[i].state->running == 0;
+            }
+            // a worker that reported its result only has to return
+            if(done) workers[i].thread.join();
+            else if(kept++ != i) workers[kept - 1] = std::move(workers[i]);
+        }
+        workers.resize(kept);
+    }
+
+    /** Wait for all workers */
+    void join()
+    {
+        for(size_t i = 0; i < workers.size(); ++i) workers[i].thread.join();
+        workers.clear();
+    }
+
+public:
+
+    /** Create a portfolio with the given number of workers
+     *
+     *  @param threads number of workers, 0 selects the number of cores
+     */
+    MaxSATPortfolio(unsigned threads = 0)
+    : nThreads(threads != 0 ? threads : std::thread::hardware_concurrency())
+    , errorCode(0)
+    {
+        if(nThreads == 0) nThreads = 1;
+    }
+
+    /** Wait for all workers, and free all resources */
+    ~MaxSATPortfolio() { join(); }
+
+    /** Return error number code in case the last call failed, see
+     *  MaxSATSolver::getErrno */
+    int getErrno() const { return errorCode; }
+
+    /** Number of workers that are started per call */
+    unsigned getThreads() const { return nThreads; }
+
+    /** Compute a MaxSAT solution for the given formula
+     *
+     *  The semantics of the parameters and the return value are the same as
+     *  for MaxSATSolver::compute_maxsat. The call returns as soon as the
+     *  first worker proved its result, or all workers finished.
+     *
+     *  Possible error codes:
+     *   -ENOMEM ... a worker could not be started, or all workers failed
+     */
+    MaxSATSolver::ReturnCode compute_maxsat(const MaxSATInstance &formula,
+                                            std::vector<int> &model,
+                                            uint64_t &cost,
+                                            uint64_t maxCost = UINT64_MAX,
+                                            const std::vector<int> *startAssignment = 0,
+                                            int64_t maxMinimizeSteps = -1)
+    {
+        reap();
+        errorCode = 0;
+        model.clear();
+        cost = UINT64_MAX;
+
+        // the backend does not accept empty formulas
+        if(formula.empty()) {
+            formula.makeModel(model);
+            cost = 0;
+            return MaxSATSolver::OPTIMAL;
+        }
+
+        std::shared_ptr<SharedState> state;
+        std::shared_ptr<const std::vector<int> > start;
+        try {
+            state = std::make_shared<SharedState>();
+            state->formula = std::make_shared<const MaxSATInstance>(formula);
+            if(startAssignment) start = std::make_shared<const std::vector<int> >(*startAssignment);
+            std::unique_lock<std::mutex> guard(state->lock);
+            workers.reserve(workers.size() + nThreads);
+            for(unsigned worker = 0; worker < nThreads; ++worker) {
+                Worker started;
+                started.state = state;
+                started.thread = std::thread(work, state, worker, start, maxCost, maxMinimizeSteps);
+                workers.push_back(std::move(started));
+                state->running++;
+            }
+        } catch (std::exception &e) {
+            if(!state || state->running == 0) {
+                errorCode = -ENOMEM;
+                return MaxSATSolver::ERROR;
+            }
+        }
+
+        std::unique_lock<std::mutex> guard(state->lock);
+        while(state->running > 0 && !isFinal(state->status)) state->finished.wait(guard);
+
+        model = state->model;
+        cost = state->cost;
+        if(state->status == MaxSATSolver::UNKNOWN && state->failed) {
+            errorCode = state->errorCode;
+            return MaxSATSolver::ERROR;
+        }
+        return state->status;
+    }
+
+    /** Compute a MaxSAT solution by solving independent parts in parallel
+     *
+     *  The formula is split into parts that do not share variables, see
+     *  MaxSATInstance::splitComponents. The workers of the portfolio take the
+     *  next unsolved part, until all parts are solved. Models of the parts
+     *  are combined, and their costs are added. Variables that do not appear
+     *  in the formula are assigned false.
+     *
+     *  The semantics of the parameters and the return value are the same as
+     *  for MaxSATSolver::compute_maxsat. The result is OPTIMAL, only if all
+     *  parts are solved optimally.
+     */
+    MaxSATSolver::ReturnCode compute_maxsat_components(const MaxSATInstance &formula,
+                                                       std::vector<int> &model,
+                                                       uint64_t &cost,
+                                                       const std::vector<int> *startAssignment = 0)
+    {
+        reap();
+        errorCode = 0;
+        model.clear();
+        cost = UINT64_MAX;
+
+        std::vector<MaxSATInstance> parts;
+        std::vector<std::vector<int> > variables;
+        formula.splitComponents(parts, variables);
+
+        std::vector<MaxSATSolver::ReturnCode> status(parts.size(), MaxSATSolver::UNKNOWN);
+        std::vector<std::vector<int> > models(parts.size());
+        std::vector<uint64_t> costs(parts.size(), 0);
+        std::vector<int> errors(parts.size(), 0);
+        std::atomic<size_t> nextPart(0);
+
+        auto solveParts = [&]() {
+            std::vector<int> start;
+            for(size_t p = nextPart++; p < parts.size(); p = nextPart++) {
+                const std::vector<int> &mapping = variables[p];
+                if(startAssignment) {
+                    start.assign(mapping.size() + 1, 0);
+                    for(size_t i = 0; i < mapping.size(); ++i) {
+                        const int v = mapping[i];
+                        if(v < (int)startAssignment->size() && (*startAssignment)[v] != 0)
+                            start[i + 1] = (*startAssignment)[v] > 0 ? (int)i + 1 : -(int)i - 1;
+                    }
+                }
+                if(parts[p].empty()) {
+                    status[p] = MaxSATSolver::OPTIMAL;
+                    continue;
+                }
+                MaxSATSolver solver(parts[p].nVars(), parts[p].nClauses());
+                if(solver.getErrno() == 0 && parts[p].loadInto(solver))
+                    status[p] = solver.compute_maxsat(models[p], costs[p], UINT64_MAX, startAssignment ? &start : 0);
+                else
+                    status[p] = MaxSATSolver::ERROR;
+                errors[p] = solver.getErrno();
+            }
+        };
+
+        // after reserving, a thread that cannot be started is not stored, and
+        // all stored threads are joined below
+        std::vector<std::thread> helpers;
+        try {
+            helpers.reserve(nThreads);
+            for(unsigned worker = 1; worker < nThreads && worker < parts.size(); ++worker)
+                helpers.emplace_back(solveParts);
+        } catch (std::exception &e) {
+            // the remaining parts are solved by the other threads
+        }
+        solveParts();
+        for(size_t i = 0; i < helpers.size(); ++i) helpers[i].join();
+
+        MaxSATSolver::ReturnCode ret = MaxSATSolver::OPTIMAL;
+        for(size_t p = 0; p < parts.size(); ++p) {
+            if(status[p] == MaxSATSolver::UNSATISFIABLE) return MaxSATSolver::UNSATISFIABLE;
+            if(status[p] == MaxSATSolver::ERROR) {
+                errorCode = errors[p];
+                ret = MaxSATSolver::ERROR;
+            } else if(status[p] == MaxSATSolver::UNKNOWN && ret != MaxSATSolver::ERROR) {
+                ret = MaxSATSolver::UNKNOWN;
+            } else if(status[p] == MaxSATSolver::SATISFIABLE && ret == MaxSATSolver::OPTIMAL) {
+                ret = MaxSATSolver::SATISFIABLE;
+            }
+        }
+        if(ret == MaxSATSolver::ERROR || ret == MaxSATSolver::UNKNOWN) return ret;
+
+        formula.makeModel(model);
+        cost = 0;
+        for(size_t p = 0; p < parts.size(); ++p) {
+            cost += costs[p];
+            for(size_t i = 0; i < variables[p].size() && i + 1 < models[p].size(); ++i)
+                if(models[p][i + 1] > 0) model[variables[p][i]] = variables[p][i];
+        }
+        return ret;
+    }
+
+    /** Solve many independent formulas in parallel
+     *
+     *  The workers of the portfolio, including the calling thread, claim
+     *  chunks of consecutive formulas via a shared counter, so that idle
+     *  workers take over the remaining formulas without any lock. Each
+     *  formula is solved by a single backend, and its result is written to
+     *  the entry of results with the same index. Entries of results that
+     *  exist already are overwritten, such that the memory of their models
+     *  is reused across batches.
+     *
+     *  Possible error codes:
+     *   -ENOMEM ... the results could not be stored
+     *   otherwise, the error code of the first failed formula
+     *
+     *  @param formulas independent formulas to be solved
+     *  @param results stores the result per formula
+     *  @param maxCost see MaxSATSolver::compute_maxsat, applied to each formula
+     *  @param maxMinimizeSteps see MaxSATSolver::compute_maxsat
+     *
+     *  @return true, if no formula failed with ERROR
+     */
+    bool compute_maxsat_batch(const std::vector<MaxSATInstance> &formulas,
+                              std::vector<BatchResult> &results,
+                              uint64_t maxCost = UINT64_MAX,
+                              int64_t maxMinimizeSteps = -1)
+    {
+        reap();
+        errorCode = 0;
+        try {
+            results.resize(formulas.size());
+        } catch (std::exception &e) {
+            errorCode = -ENOMEM;
+            return false;
+        }
+
+        // small chunks balance the load, larger chunks reduce contention
+        const size_t n = formulas.size();
+        const size_t chunk = std::max<size_t>(1, std::min<size_t>(64, n / (8 * (size_t)nThreads)));
+        std::atomic<size_t> next(0);
+        auto solveChunks = [&]() {
+            for(size_t begin = next.fetch_add(chunk); begin < n; begin = next.fetch_add(chunk)) {
+                const size_t end = std::min(begin + chunk, n);
+                for(size_t i = begin; i < end; ++i) solveSingle(formulas[i], results[i], maxCost, maxMinimizeSteps);
+            }
+        };
+
+        std::vector<std::thread> helpers;
+        try {
+            helpers.reserve(nThreads);
+            for(unsigned worker = 1; worker < nThreads && worker * chunk < n; ++worker)
+                helpers.emplace_back(solveChunks);
+        } catch (std::exception &e) {
+            // the remaining formulas are solved by the other threads
+        }
+        solveChunks();
+        for(size_t i = 0; i < helpers.size(); ++i) helpers[i].join();
+
+        for(size_t i = 0; i < n; ++i) {
+            if(results[i].status != MaxSATSolver::ERROR) continue;
+            errorCode = results[i].errorCode;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,508 @@
+/**********************************************************************************[MaxSATPreprocessor.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATPreprocessor_Interface_h
+#define MaxSATPreprocessor_Interface_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "MaxSATInstance.h"
+
+/** Class to simplify a MaxSAT formula before handing it to a solver
+ *
+ *  The following techniques are applied once, in this order:
+ *
+ *   - removal of duplicate literals and tautologies
+ *   - unit propagation over hard clauses and at-most-k constraints
+ *   - failed literal detection on the binary implication graph of the hard
+ *     clauses
+ *   - subsumption and self-subsuming resolution with hard clauses, applied
+ *     to hard and soft clauses
+ *   - merging of soft clauses with the same literals, by adding up weights
+ *
+ *  Soft clauses are never used to simplify other clauses. Satisfied soft
+ *  clauses are dropped, and the weight of falsified soft clauses is collected
+ *  as fixed cost. The simplified formula uses the same variables as the input,
+ *  hence a model of the simplified formula is extended to a model of the
+ *  input by adding the values of the fixed variables with extendModel.
+ */
+class MaxSATPreprocessor {
+
+public:
+
+    /** Counters of the applied simplifications */
+    struct Statistics {
+        uint64_t fixedVariables;
+        uint64_t failedLiterals;
+        uint64_t removedClauses;
+        uint64_t removedLiterals;
+        uint64_t mergedSoftClauses;
+
+        Statistics() : fixedVariables(0), failedLiterals(0), removedClauses(0), removedLiterals(0), mergedSoftClauses(0) {}
+    };
+
+private:
+
+    /** clause with its weight, 0 for hard clauses */
+    struct Clause {
+        std::vector<int> literals;
+        uint64_t weight;
+        bool removed;
+    };
+
+    /** at-most-k constraint */
+    struct AtMostK {
+        std::vector<int> literals;
+        int64_t bound;
+    };
+
+    /** the simplified formula */
+    MaxSATInstance simplified;
+
+    /** value of each variable: 1 true, -1 false, 0 unassigned */
+    std::vector<int> values;
+
+    /** sum of the weights of soft clauses falsified by fixed variables */
+    uint64_t fixedCost;
+
+    /** limit on the steps of subsumption checks */
+    uint64_t subsumptionLimit;
+
+    /** limit on the edges visited while probing binary implications */
+    uint64_t probingLimit;
+
+    Statistics statistics;
+
+    /** clauses and constraints while simplifying */
+    std::vector<Clause> clauses;
+    std::vector<AtMostK> constraints;
+
+    /** stamps per literal to check subsumption */
+    std::vector<uint32_t> marks;
+
+    /** Index of a literal in occurrence lists */
+    static size_t index(int literal) { return 2 * (size_t)std::abs((int64_t)literal) + (literal < 0); }
+
+    /** Value of a literal: 1 true, -1 false, 0 unassigned */
+    int value(int literal) const
+    {
+        const int v = values[std::abs((int64_t)literal)];
+        return literal > 0 ? v : -v;
+    }
+
+    /** Assign a literal to true, return false on conflict */
+    bool assign(int literal, std::vector<int> &queue)
+    {
+        const int v = value(literal);
+        if(v != 0) return v > 0;
+        values[std::abs((int64_t)literal)] = literal > 0 ? 1 : -1;
+        queue.push_back(literal);
+        statistics.fixedVariables++;
+        return true;
+    }
+
+    /** Sort literals, remove duplicates, and detect tautologies
+     *
+     *  @return false, if the clause is a tautology
+     */
+    static bool normalize(std::vector<int> &literals)
+    {
+        std::sort(literals.begin(), literals.end());
+        literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+        for(size_t i = 0; i + 1 < literals.size(); ++i) {
+            for(size_t j = i + 1; j < literals.size(); ++j)
+                if(literals[j] == -literals[i]) return false;
+        }
+        return true;
+    }
+
+    /** Propagate units over hard clauses and at-most-k constraints
+     *
+     *  Hard clauses count their literals that are not known to be false,
+     *  at-most-k constraints count their true literals, such that each
+     *  assignment is processed once per occurrence. Assignments that are in
+     *  the queue already are part of the initial counts.
+     *
+     *  @return false, if the hard part of the formula is unsatisfiable
+     */
+    bool propagate(std::vector<int> &queue)
+    {
+        const size_t literals = 2 * values.size();
+        std::vector<std::vector<size_t> > clauseOcc(literals), amkOcc(literals);
+        std::vector<size_t> open(clauses.size(), 0);
+        std::vector<int64_t> trueCount(constraints.size(), 0);
+        std::vector<bool> satisfied(clauses.size(), false);
+        std::vector<int> pending;
+
+        for(size_t c = 0; c < clauses.size(); ++c) {
+            if(clauses[c].weight != 0 || clauses[c].removed) continue;
+            int last = 0;
+            for(size_t i = 0; i < clauses[c].literals.size(); ++i) {
+                const int l = clauses[c].literals[i];
+                clauseOcc[index(l)].push_back(c);
+                const int v = value(l);
+                if(v > 0) satisfied[c] = true;
+                if(v == 0) { open[c]++; last = l; }
+            }
+            if(satisfied[c]) continue;
+            if(open[c] == 0) return false;
+            if(open[c] == 1) pending.push_back(last);
+        }
+        for(size_t a = 0; a < constraints.size(); ++a) {
+            for(size_t i = 0; i < constraints[a].literals.size(); ++i) {
+                const int l = constraints[a].literals[i];
+                amkOcc[index(l)].push_back(a);
+                if(value(l) > 0) trueCount[a]++;
+            }
+            if(trueCount[a] > constraints[a].bound) return false;
+            if(trueCount[a] == constraints[a].bound) {
+                for(size_t i = 0; i < constraints[a].literals.size(); ++i)
+                    if(value(constraints[a].literals[i]) == 0) pending.push_back(-constraints[a].literals[i]);
+            }
+        }
+
+        size_t head = queue.size();
+        for(size_t i = 0; i < pending.size(); ++i)
+            if(!assign(pending[i], queue)) return false;
+
+        for(; head < queue.size(); ++head) {
+            const int l = queue[head];
+            const std::vector<size_t> &sat = clauseOcc[index(l)];
+            for(size_t i = 0; i < sat.size(); ++i) satisfied[sat[i]] = true;
+
+            const std::vector<size_t> &shrink = clauseOcc[index(-l)];
+            for(size_t i = 0; i < shrink.size(); ++i) {
+                const size_t c = shrink[i];
+                if(satisfied[c]) continue;
+                if(--open[c] == 0) return false;
+                if(open[c] != 1) continue;
+                // the remaining literal might be true already, then assign succeeds
+                for(size_t j = 0; j < clauses[c].literals.size(); ++j) {
+                    const int other = clauses[c].literals[j];
+                    if(value(other) >= 0 && !assign(other, queue)) return false;
+                }
+            }
+
+            const std::vector<size_t> &count = amkOcc[index(l)];
+            for(size_t i = 0; i < count.size(); ++i) {
+                const size_t a = count[i];
+                if(++trueCount[a] > constraints[a].bound) return false;
+                if(trueCount[a] == constraints[a].bound) {
+                    for(size_t j = 0; j < constraints[a].literals.size(); ++j)
+                        if(value(constraints[a].literals[j]) == 0 && !assign(-constraints[a].literals[j], queue)) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /** Detect literals that imply a literal and its complement via binary
+     *  hard clauses, and assign their complement
+     *
+     *  Roots of the implication graph are probed first. Literals that are
+     *  reached by a probe that did not fail cannot fail themselves, so they
+     *  are neither probed nor expanded again. This misses conflicts between
+     *  their implications and those of later probes, but keeps the effort
+     *  linear. The number of visited edges is bounded by probingLimit.
+     *
+     *  @return false, if the hard part of the formula is unsatisfiable
+     */
+    bool probeBinaryImplications(std::vector<int> &queue)
+    {
+        const size_t literals = 2 * values.size();
+        std::vector<std::vector<int> > implied(literals);
+        for(size_t c = 0; c < clauses.size(); ++c) {
+            const std::vector<int> &lits = clauses[c].literals;
+            if(clauses[c].weight != 0 || clauses[c].removed || lits.size() != 2) continue;
+            implied[index(-lits[0])].push_back(lits[1]);
+            implied[index(-lits[1])].push_back(lits[0]);
+        }
+
+        // a literal has no predecessor, if its complement implies nothing
+        std::vector<int> probes;
+        for(int pass = 0; pass < 2; ++pass) {
+            for(int v = 1; v < (int)values.size(); ++v) {
+                for(int sign = 0; sign < 2; ++sign) {
+                    const int probe = sign ? -v : v;
+                    if(implied[index(probe)].empty() || implied[index(-probe)].empty() != (pass == 0)) continue;
+                    probes.push_back(probe);
+                }
+            }
+        }
+
+        std::vector<uint32_t> seen(literals, 0);
+        std::vector<bool> cannotFail(literals, false);
+        uint32_t stamp = 0;
+        uint64_t steps = 0;
+        std::vector<int> stack, reached;
+        for(size_t p = 0; p < probes.size() && steps < probingLimit; ++p) {
+            const int probe = probes[p];
+            if(values[std::abs((int64_t)probe)] != 0 || cannotFail[index(probe)]) continue;
+            ++stamp;
+            stack.assign(1, probe);
+            reached.assign(1, probe);
+            seen[index(probe)] = stamp;
+            bool failed = false;
+            while(!stack.empty() && !failed) {
+                const int l = stack.back();
+                stack.pop_back();
+                const std::vector<int> &next = implied[index(l)];
+                steps += next.size();
+                for(size_t i = 0; i < next.size(); ++i) {
+                    if(value(next[i]) > 0) continue;
+                    if(seen[index(-next[i])] == stamp || value(next[i]) < 0) { failed = true; break; }
+                    if(seen[index(next[i])] == stamp) continue;
+                    seen[index(next[i])] = stamp;
+                    if(cannotFail[index(next[i])]) continue;
+                    stack.push_back(next[i]);
+                    reached.push_back(next[i]);
+                }
+            }
+            if(failed) {
+                statistics.failedLiterals++;
+                if(!assign(-probe, queue)) return false;
+            } else {
+                for(size_t i = 0; i < reached.size(); ++i) cannotFail[index(reached[i])] = true;
+            }
+        }
+        return true;
+    }
+
+    /** Remove assigned literals and satisfied clauses
+     *
+     *  @return false, if a hard clause is falsified
+     */
+    bool removeAssigned()
+    {
+        for(size_t c = 0; c < clauses.size(); ++c) {
+            Clause &clause = clauses[c];
+            if(clause.removed) continue;
+            size_t kept = 0;
+            bool isSatisfied = false;
+            for(size_t i = 0; i < clause.literals.size(); ++i) {
+                const int v = value(clause.literals[i]);
+                if(v > 0) isSatisfied = true;
+                if(v == 0) clause.literals[kept++] = clause.literals[i];
+            }
+            statistics.removedLiterals += clause.literals.size() - kept;
+            clause.literals.resize(kept);
+            if(isSatisfied) {
+                clause.removed = true;
+                statistics.removedClauses++;
+            } else if(kept == 0) {
+                if(clause.weight == 0) return false;
+                fixedCost += clause.weight;
+                clause.removed = true;
+                statistics.removedClauses++;
+            }
+        }
+        for(size_t a = 0; a < constraints.size(); ++a) {
+            AtMostK &constraint = constraints[a];
+            size_t kept = 0;
+            for(size_t i = 0; i < constraint.literals.size(); ++i) {
+                const int v = value(constraint.literals[i]);
+                if(v > 0) constraint.bound--;
+                if(v == 0) constraint.literals[kept++] = constraint.literals[i];
+            }
+            constraint.literals.resize(kept);
+            if(constraint.bound < 0) return false;
+        }
+        return true;
+    }
+
+    /** Check whether all literals of clause are part of the marked clause,
+     *  where the literal flipped has to be part of it negated */
+    bool subsetOfMarked(const std::vector<int> &clause, int flipped, uint32_t stamp) const
+    {
+        for(size_t i = 0; i < clause.size(); ++i) {
+            const int l = clause[i] == flipped ? -flipped : clause[i];
+            if(marks[index(l)] != stamp) return false;
+        }
+        return true;
+    }
+
+    /** Remove clauses subsumed by hard clauses, and strengthen clauses by
+     *  self-subsuming resolution with hard clauses */
+    void subsume()
+    {
+        const size_t literals = 2 * values.size();
+        std::vector<std::vector<size_t> > occ(literals);
+        for(size_t c = 0; c < clauses.size(); ++c) {
+            if(clauses[c].removed) continue;
+            for(size_t i = 0; i < clauses[c].literals.size(); ++i) occ[index(clauses[c].literals[i])].push_back(c);
+        }
+
+        std::vector<size_t> order;
+        for(size_t c = 0; c < clauses.size(); ++c)
+            if(!clauses[c].removed && clauses[c].weight == 0 && !clauses[c].literals.empty()) order.push_back(c);
+        struct BySize {
+            const std::vector<Clause> &clauses;
+            BySize(const std::vector<Clause> &c) : clauses(c) {}
+            bool operator()(size_t a, size_t b) const { return clauses[a].literals.size() < clauses[b].literals.size(); }
+        };
+        std::stable_sort(order.begin(), order.end(), BySize(clauses));
+
+        marks.assign(literals, 0);
+        uint32_t stamp = 0;
+        uint64_t steps = 0;
+        for(size_t o = 0; o < order.size() && steps < subsumptionLimit; ++o) {
+            const size_t c = order[o];
+            if(clauses[c].removed) continue;
+            const std::vector<int> small = clauses[c].literals;
+
+            for(size_t i = 0; i < small.size(); ++i) {
+                // subsumption needs to be checked for one literal only
+                for(int pass = (i == 0 ? 0 : 1); pass < 2; ++pass) {
+                    const int l = pass == 0 ? small[0] : -small[i];
+                    const std::vector<size_t> &candidates = occ[index(l)];
+                    for(size_t k = 0; k < candidates.size(); ++k) {
+                        const size_t d = candidates[k];
+                        Clause &other = clauses[d];
+                        if(d == c || other.removed || other.literals.size() < small.size()) continue;
+                        steps += small.size() + other.literals.size();
+                        ++stamp;
+                        for(size_t j = 0; j < other.literals.size(); ++j) marks[index(other.literals[j])] = stamp;
+                        if(pass == 0) {
+                            if(!subsetOfMarked(small, 0, stamp)) continue;
+                            // clauses with the same literals are kept once
+                            if(other.literals.size() == small.size() && other.weight == 0 && d < c) continue;
+                            other.removed = true;
+                            statistics.removedClauses++;
+                        } else {
+                            if(!subsetOfMarked(small, small[i], stamp)) continue;
+                            other.literals.erase(std::find(other.literals.begin(), other.literals.end(), -small[i]));
+                            statistics.removedLiterals++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /** Merge soft clauses with the same literals */
+    void mergeSoftClauses()
+    {
+        std::map<std::vector<int>, size_t> first;
+        for(size_t c = 0; c < clauses.size(); ++c) {
+            Clause &clause = clauses[c];
+            if(clause.removed || clause.weight == 0) continue;
+            std::map<std::vector<int>, size_t>::iterator it = first.find(clause.literals);
+            if(it == first.end()) {
+                first[clause.literals] = c;
+                continue;
+            }
+            uint64_t &weight = clauses[it->second].weight;
+            weight = weight > UINT64_MAX - clause.weight ? UINT64_MAX : weight + clause.weight;
+            clause.removed = true;
+            statistics.mergedSoftClauses++;
+        }
+    }
+
+public:
+
+    MaxSATPreprocessor() : fixedCost(0), subsumptionLimit(100000000), probingLimit(100000000) {}
+
+    /** Limit the effort spent on subsumption checks */
+    void setSubsumptionLimit(uint64_t steps) { subsumptionLimit = steps; }
+
+    /** Limit the effort spent on failed literal detection */
+    void setProbingLimit(uint64_t steps) { probingLimit = steps; }
+
+    /** Simplify the given formula
+     *
+     *  @param input formula to be simplified
+     *  @param withSoftClauses if false, soft clauses of the input are ignored
+     *  @param units literals that are added as unit hard clauses, if not 0
+     *
+     *  @return false, if the hard part of the formula is unsatisfiable.
+     *          Otherwise, the simplified formula can be accessed via
+     *          getFormula.
+     */
+    bool simplify(const MaxSATInstance &input, bool withSoftClauses = true, const std::vector<int> *units = 0)
+    {
+        const int nVars = input.nVars();
+        simplified = MaxSATInstance(nVars);
+        values.assign(nVars + 1, 0);
+        fixedCost = 0;
+        statistics = Statistics();
+        clauses.clear();
+        constraints.clear();
+
+        std::vector<int> queue;
+        for(size_t i = 0; units && i < units->size(); ++i)
+            if(!assign((*units)[i], queue)) return false;
+
+        for(size_t c = 0; c < input.nClauses(); ++c) {
+            if(!withSoftClauses && input.weight(c) != 0) continue;
+            Clause clause;
+            clause.literals.assign(input.clause(c), input.clause(c) + input.clauseSize(c));
+            clause.weight = input.weight(c);
+            clause.removed = false;
+            if(!normalize(clause.literals)) {
+                statistics.removedClauses++;
+                continue;
+            }
+            if(clause.literals.empty() && clause.weight == 0) return false;
+            clauses.push_back(clause);
+        }
+        for(size_t a = 0; a < input.nAtMostK(); ++a) {
+            AtMostK constraint;
+            constraint.literals.assign(input.atMostK(a), input.atMostK(a) + input.atMostKSize(a));
+            constraint.bound = input.atMostKBound(a);
+            constraints.push_back(constraint);
+        }
+
+        if(!propagate(queue) || !removeAssigned()) return false;
+        const uint64_t fixedBefore = statistics.fixedVariables;
+        if(!probeBinaryImplications(queue)) return false;
+        if(statistics.fixedVariables != fixedBefore && (!propagate(queue) || !removeAssigned())) return false;
+
+        // strengthening might create new units
+        subsume();
+        queue.clear();
+        if(!propagate(queue) || !removeAssigned()) return false;
+        mergeSoftClauses();
+
+        for(size_t c = 0; c < clauses.size(); ++c)
+            if(!clauses[c].removed) simplified.addClause(clauses[c].literals, clauses[c].weight);
+        for(size_t a = 0; a < constraints.size(); ++a) {
+            if(constraints[a].bound >= (int64_t)constraints[a].literals.size()) continue;
+            simplified.addAtMostK(constraints[a].literals, constraints[a].bound);
+        }
+        clauses.clear();
+        constraints.clear();
+        marks.clear();
+        return true;
+    }
+
+    /** The simplified formula of the last successful call to simplify */
+    const MaxSATInstance &getFormula() const { return simplified; }
+
+    /** Weight of soft clauses that are falsified in every model */
+    uint64_t getFixedCost() const { return fixedCost; }
+
+    /** Counters of the last call to simplify */
+    const Statistics &getStatistics() const { return statistics; }
+
+    /** Turn a model of the simplified formula into a model of the input, by
+     *  adding the values of fixed variables
+     */
+    void extendModel(std::vector<int> &model) const
+    {
+        if(model.size() < values.size()) {
+            const std::vector<int> assignment(model);
+            simplified.makeModel(model, &assignment);
+        }
+        for(size_t v = 1; v < values.size(); ++v)
+            if(values[v] != 0) model[v] = values[v] > 0 ? (int)v : -(int)v;
+    }
+};
+
+#endif
@@ -0,0 +1,442 @@
+/**********************************************************************************[MaxSATReader.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATReader_Interface_h
+#define MaxSATReader_Interface_h
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "MaxSATInstance.h"
+
+/** Class to read MaxSAT formulas from files
+ *
+ *  The following input formats are supported, and detected automatically:
+ *
+ *   - WCNF with header line "p wcnf <vars> <clauses> [<top>]", where clauses
+ *     with a weight of at least top are hard clauses
+ *   - CNF with header line "p cnf <vars> <clauses>", with hard clauses only
+ *   - WCNF without header line, as used since the MaxSAT Evaluation 2022,
+ *     where hard clauses start with "h", and soft clauses with their weight
+ *   - OPB, with a minimization objective, and linear constraints, which are
+ *     added via MaxSATInstance::addPB
+ *
+ *  Plain files are mapped into memory, and parsed without copying them.
+ *  Files compressed with gzip are decompressed into memory before parsing.
+ *  Soft clauses with weight 0 are dropped, as they never cause any cost.
+ *
+ *  Note: for OPB, the objective is turned into unit soft clauses. Constant
+ *  offsets of the objective, e.g. due to negative coefficients, are not
+ *  reported as part of the cost.
+ *
+ *  Possible error codes:
+ *   -ENOENT ... the file cannot be opened
+ *   -EINVAL ... the input does not match the detected format
+ *   -ENOMEM ... the formula cannot be stored
+ */
+class MaxSATReader {
+
+    /** error code of the last failed call */
+    int errorCode;
+
+    /** line of the input in which the last error has been detected */
+    size_t errorLine;
+
+    /** current position, and end of the input */
+    const char *pos;
+    const char *end;
+
+    /** current line number */
+    size_t line;
+
+    /** literals of the constraint that is currently parsed */
+    std::vector<int> literals;
+
+    /** coefficients of the OPB constraint that is currently parsed */
+    std::vector<int64_t> coefficients;
+
+    /** Record an error at the current line, and return false */
+    bool fail(int code)
+    {
+        errorCode = code;
+        errorLine = line;
+        return false;
+    }
+
+    /** Skip spaces and tabs, but stop at the end of a line */
+    void skipBlanks()
+    {
+        while(pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) ++pos;
+    }
+
+    /** Skip all whitespace, and count lines */
+    void skipWhitespace()
+    {
+        while(pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')) {
+            if(*pos == '\n') ++line;
+            ++pos;
+        }
+    }
+
+    /** Skip the remainder of the current line, including the line break */
+    void skipLine()
+    {
+        const char *next = (const char *)memchr(pos, '\n', end - pos);
+        pos = next ? next + 1 : end;
+        ++line;
+    }
+
+    /** Parse an unsigned 64 bit number at the current position */
+    bool parseUnsigned(uint64_t &value)
+    {
+        skipBlanks();
+        if(pos == end || *pos < '0' || *pos > '9') return false;
+        value = 0;
+        while(pos < end && *pos >= '0' && *pos <= '9') {
+            const uint64_t digit = *pos - '0';
+            if(value > (UINT64_MAX - digit) / 10) return false;
+            value = value * 10 + digit;
+            ++pos;
+        }
+        return true;
+    }
+
+    /** Parse a signed number at the current position */
+    bool parseSigned(int64_t &value)
+    {
+        skipBlanks();
+        bool negative = false;
+        if(pos < end && (*pos == '-' || *pos == '+')) {
+            negative = *pos == '-';
+            ++pos;
+        }
+        uint64_t magnitude = 0;
+        if(!parseUnsigned(magnitude) || magnitude > (uint64_t)INT64_MAX) return false;
+        value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+        return true;
+    }
+
+    /** Parse 0-terminated literals into the literals buffer */
+    bool parseClause(MaxSATInstance &formula)
+    {
+        literals.clear();
+        while(true) {
+            skipWhitespace();
+            int64_t literal = 0;
+            if(!parseSigned(literal) || literal < -INT32_MAX || literal > INT32_MAX) return false;
+            if(literal == 0) return true;
+            formula.reserveVars(std::abs(literal));
+            literals.push_back(literal);
+        }
+    }
+
+    /** Add the given literals as clause, hard if weight is 0 */
+    bool addClause(MaxSATInstance &formula, const std::vector<int> &clause, uint64_t weight)
+    {
+        try {
+            if(!formula.addClause(clause.data(), clause.size(), weight))
+                return fail(formula.getErrno());
+        } catch (std::exception &e) {
+            return fail(-ENOMEM);
+        }
+        return true;
+    }
+
+    /** Parse a formula in (W)CNF format
+     *
+     *  @param newFormat whether the input has no header line, and hard clauses
+     *         are marked with "h"
+     */
+    bool parseWCNF(MaxSATInstance &formula, bool newFormat)
+    {
+        bool weighted = newFormat;
+        uint64_t top = UINT64_MAX;
+        bool seenHeader = false;
+
+        while(true) {
+            skipWhitespace();
+            if(pos == end) break;
+            if(*pos == 'c') { skipLine(); continue; }
+
+            if(*pos == 'p') {
+                if(newFormat || seenHeader) return fail(-EINVAL);
+                ++pos;
+                skipBlanks();
+                if(end - pos >= 4 && strncmp(pos, "wcnf", 4) == 0) { weighted = true; pos += 4; }
+                else if(end - pos >= 3 && strncmp(pos, "cnf", 3) == 0) { pos += 3; }
+                else return fail(-EINVAL);
+                uint64_t vars = 0, clauses = 0;
+                if(!parseUnsigned(vars) || !parseUnsigned(clauses) || vars > INT32_MAX) return fail(-EINVAL);
+                if(weighted) parseUnsigned(top);
+                formula.reserveVars(vars);
+                seenHeader = true;
+                skipLine();
+                continue;
+            }
+
+            uint64_t weight = 0;
+            bool droppedClause = false;
+            if(newFormat && *pos == 'h') {
+                ++pos;
+            } else if(weighted) {
+                if(!parseUnsigned(weight)) return fail(-EINVAL);
+                if(weight >= top) weight = 0;
+                else if(weight == 0) droppedClause = true;
+            }
+
+            if(!parseClause(formula)) return fail(-EINVAL);
+            if(droppedClause) continue;
+            if(!addClause(formula, literals, weight)) return false;
+        }
+        return true;
+    }
+
+    /** Add delta to value, return false if the result does not fit into int64_t */
+    static bool checkedAdd(int64_t &value, int64_t delta)
+    {
+        if(delta > 0 ? value > INT64_MAX - delta : value < INT64_MIN - delta) return false;
+        value += delta;
+        return true;
+    }
+
+    /** Parse an OPB term "<coefficient> [~]x<variable>", return false if the
+     *  current position does not start a term */
+    bool parseTerm(int64_t &coefficient, int &literal)
+    {
+        skipWhitespace();
+        const char *start = pos;
+        if(!parseSigned(coefficient)) { pos = start; return false; }
+        skipBlanks();
+        bool negated = false;
+        if(pos < end && *pos == '~') { negated = true; ++pos; }
+        if(pos == end || *pos != 'x') { pos = start; return false; }
+        ++pos;
+        uint64_t variable = 0;
+        if(!parseUnsigned(variable) || variable == 0 || variable > INT32_MAX) { pos = start; return false; }
+        literal = negated ? -(int)variable : (int)variable;
+        return true;
+    }
+
+    /** Parse the terms of an OPB constraint, or objective, into literals and
+     *  coefficients, such that all coefficients are positive
+     *
+     *  @param constant receives the value that has to be subtracted from the
+     *         right hand side, to compensate turning negative coefficients
+     *         into positive ones
+     *  @return false, if the constant does not fit into int64_t
+     */
+    bool parseTerms(MaxSATInstance &formula, int64_t &constant)
+    {
+        literals.clear();
+        coefficients.clear();
+        constant = 0;
+        int64_t coefficient = 0;
+        int literal = 0;
+        while(parseTerm(coefficient, literal)) {
+            formula.reserveVars(std::abs(literal));
+            if(coefficient == 0) continue;
+            // a*l with a < 0 is equal to a + (-a)*~l
+            if(coefficient < 0) {
+                if(!checkedAdd(constant, coefficient)) return false;
+                coefficient = -coefficient;
+                literal = -literal;
+            }
+            literals.push_back(literal);
+            coefficients.push_back(coefficient);
+        }
+        return true;
+    }
+
+    /** Add the constraint sum(coefficients * literals) <= bound */
+    bool addLessEqual(MaxSATInstance &formula, int64_t bound)
+    {
+        if(bound < 0) return addClause(formula, std::vector<int>(), 0);
+        try {
+            const std::vector<uint64_t> weights(coefficients.begin(), coefficients.end());
+            if(!formula.addPB(literals, weights, bound)) return fail(formula.getErrno());
+        } catch (std::exception &e) {
+            return fail(-ENOMEM);
+        }
+        return true;
+    }
+
+    /** Parse a formula in OPB format */
+    bool parseOPB(MaxSATInstance &formula)
+    {
+        while(true) {
+            skipWhitespace();
+            if(pos == end) break;
+            if(*pos == '*') { skipLine(); continue; }
+
+            if(end - pos >= 4 && strncmp(pos, "min:", 4) == 0) {
+                pos += 4;
+                int64_t constant = 0;
+                if(!parseTerms(formula, constant)) return fail(-EINVAL);
+                // minimizing c*l is the same as paying c, if the clause ~l is falsified
+                std::vector<int> unit(1, 0);
+                for(size_t i = 0; i < literals.size(); ++i) {
+                    unit[0] = -literals[i];
+                    if(!addClause(formula, unit, coefficients[i])) return false;
+                }
+            } else {
+                int64_t constant = 0;
+                if(!parseTerms(formula, constant)) return fail(-EINVAL);
+                skipBlanks();
+                int relation = 0;
+                if(end - pos >= 2 && strncmp(pos, ">=", 2) == 0) { relation = 1; pos += 2; }
+                else if(end - pos >= 2 && strncmp(pos, "<=", 2) == 0) { relation = -1; pos += 2; }
+                else if(pos < end && *pos == '=') { relation = 0; ++pos; }
+                else return fail(-EINVAL);
+                int64_t bound = 0;
+                if(!parseSigned(bound)) return fail(-EINVAL);
+                // constant is not positive, so negating it cannot overflow
+                if(!checkedAdd(bound, -constant)) return fail(-EINVAL);
+
+                if(relation <= 0 && !addLessEqual(formula, bound)) return false;
+                if(relation >= 0) {
+                    // sum(a*l) >= b is the same as sum(a*~l) <= sum(a) - b
+                    int64_t sum = 0;
+                    for(size_t i = 0; i < literals.size(); ++i) {
+                        literals[i] = -literals[i];
+                        if(!checkedAdd(sum, coefficients[i])) return fail(-EINVAL);
+                    }
+                    if(!checkedAdd(sum, -bound)) return fail(-EINVAL);
+                    if(!addLessEqual(formula, sum)) return false;
+                }
+            }
+
+            skipBlanks();
+            if(pos == end || *pos != ';') return fail(-EINVAL);
+            ++pos;
+        }
+        return true;
+    }
+
+    /** Return true, if the line starting at scan contains a variable x<n> or
+     *  a relational operator, which do not appear in WCNF clauses */
+    bool looksLikeOPB(const char *scan) const
+    {
+        for(; scan < end && *scan != '\n'; ++scan) {
+            if(*scan == '=' || *scan == '<' || *scan == '>') return true;
+            if(*scan == 'x' && scan + 1 < end && scan[1] >= '0' && scan[1] <= '9') return true;
+        }
+        return false;
+    }
+
+    /** Decompress a gzip file into memory, and parse it */
+    bool readCompressed(const char *filename, MaxSATInstance &formula)
+    {
+        gzFile in = gzopen(filename, "rb");
+        if(!in) return fail(-ENOENT);
+        gzbuffer(in, 1 << 20);
+        std::vector<char> data;
+        try {
+            size_t used = 0;
+            data.resize(1 << 20);
+            while(true) {
+                const int n = gzread(in, &data[used], data.size() - used);
+                if(n < 0) {
+                    gzclose(in);
+                    return fail(-EINVAL);
+                }
+                if(n == 0) break;
+                used += n;
+                if(used == data.size()) data.resize(2 * data.size());
+            }
+            data.resize(used);
+        } catch (std::exception &e) {
+            gzclose(in);
+            return fail(-ENOMEM);
+        }
+        gzclose(in);
+        return readBuffer(data.data(), data.size(), formula);
+    }
+public:
+
+    MaxSATReader() : errorCode(0), errorLine(0), pos(0), end(0), line(1) {}
+
+    /** Return error code of the last failed call, or 0 */
+    int getErrno() const { return errorCode; }
+
+    /** Return the line of the input in which the last error was detected */
+    size_t getErrorLine() const { return errorLine; }
+
+    /** Parse a formula from memory, and add it to the given formula
+     *
+     *  @return true, if the whole input could be added
+     */
+    bool readBuffer(const char *data, size_t size, MaxSATInstance &formula)
+    {
+        errorCode = 0;
+        errorLine = 0;
+        pos = data;
+        end = data + size;
+        line = 1;
+
+        // detect the format based on the first line that is not a comment
+        const char *scan = data;
+        while(scan < end) {
+            while(scan < end && (*scan == ' ' || *scan == '\t' || *scan == '\r' || *scan == '\n')) ++scan;
+            if(scan == end || (*scan != 'c' && *scan != '*')) break;
+            if(*scan == '*') return parseOPB(formula);
+            const char *next = (const char *)memchr(scan, '\n', end - scan);
+            scan = next ? next + 1 : end;
+        }
+        if(scan == end || *scan == 'p') return parseWCNF(formula, false);
+        if(*scan == 'h' || (*scan >= '0' && *scan <= '9' && !looksLikeOPB(scan))) return parseWCNF(formula, true);
+        return parseOPB(formula);
+    }
+
+    /** Read a formula from a file, and add it to the given formula
+     *
+     *  @return true, if the whole file could be added
+     */
+    bool read(const char *filename, MaxSATInstance &formula)
+    {
+        errorCode = 0;
+        errorLine = 0;
+
+        int fd = open(filename, O_RDONLY);
+        if(fd == -1) return fail(-ENOENT);
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            close(fd);
+            return fail(-ENOENT);
+        }
+        const size_t size = info.st_size;
+
+        unsigned char magic[2] = {0, 0};
+        const bool compressed = size >= 2 && pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+        if(compressed) {
+            close(fd);
+            return readCompressed(filename, formula);
+        }
+        if(size == 0) {
+            close(fd);
+            return readBuffer("", 0, formula);
+        }
+
+        void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(data == MAP_FAILED) return fail(-ENOMEM);
+        madvise(data, size, MADV_SEQUENTIAL);
+        const bool ret = readBuffer((const char *)data, size, formula);
+        munmap(data, size);
+        return ret;
+    }
+};
+
+#endif
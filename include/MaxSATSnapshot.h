@@ -0,0 +1,116 @@
+/**********************************************************************************[MaxSATSnapshot.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATSnapshot_Interface_h
+#define MaxSATSnapshot_Interface_h
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MaxSATInstance.h"
+
+/** Class to store fully constructed formulas in files, and load them again
+ *
+ *  The files use the binary format of MaxSATInstance::serialize. Cardinality
+ *  and pseudo-Boolean constraints that have been encoded into clauses are
+ *  stored with their encoding, and a formula that has been simplified with
+ *  MaxSATPreprocessor can be stored via MaxSATPreprocessor::getFormula.
+ *  Loading a file maps it into memory, and copies the buffers of the formula
+ *  without parsing or encoding the constraints again.
+ *
+ *  Note: the state of the MaxSATSolver backend, e.g. its learnt clauses, or
+ *  the encodings of at-most-k constraints that are left to the library, is
+ *  not accessible, and hence not part of a snapshot.
+ *
+ *  Possible error codes:
+ *   -ENOENT ... the file cannot be opened
+ *   -EIO    ... the file cannot be written completely
+ *   -EINVAL ... the file does not contain a formula in the binary format
+ *   -ENOMEM ... the formula cannot be stored
+ */
+class MaxSATSnapshot {
+
+    /** error code of the last failed call */
+    int errorCode;
+
+    /** Record an error, and return false */
+    bool fail(int code)
+    {
+        errorCode = code;
+        return false;
+    }
+
+public:
+
+    MaxSATSnapshot() : errorCode(0) {}
+
+    /** Return error code of the last failed call, or 0 */
+    int getErrno() const { return errorCode; }
+
+    /** Write the formula to a file, replacing its content
+     *
+     *  @return true, if the whole formula has been written
+     */
+    bool write(const MaxSATInstance &formula, const char *filename)
+    {
+        errorCode = 0;
+        std::vector<char> buffer;
+        if(!formula.serialize(buffer)) return fail(-ENOMEM);
+
+        int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd == -1) return fail(-ENOENT);
+        size_t written = 0;
+        while(written < buffer.size()) {
+            const ssize_t ret = ::write(fd, buffer.data() + written, buffer.size() - written);
+            if(ret < 0 && errno == EINTR) continue;
+            if(ret <= 0) break;
+            written += ret;
+        }
+        const bool closed = close(fd) == 0;
+        if(written != buffer.size() || !closed) return fail(-EIO);
+        return true;
+    }
+
+    /** Replace the formula by the formula stored in a file
+     *
+     *  @return true, if the formula has been replaced, otherwise the formula
+     *          is empty
+     */
+    bool read(const char *filename, MaxSATInstance &formula)
+    {
+        errorCode = 0;
+        int fd = open(filename, O_RDONLY);
+        if(fd == -1) return fail(-ENOENT);
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            close(fd);
+            return fail(-ENOENT);
+        }
+        const size_t size = info.st_size;
+        if(size == 0) {
+            close(fd);
+            formula.deserialize("", 0);
+            return fail(formula.getErrno());
+        }
+
+        void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(data == MAP_FAILED) return fail(-ENOMEM);
+        madvise(data, size, MADV_SEQUENTIAL);
+        const bool ret = formula.deserialize((const char *)data, size);
+        munmap(data, size);
+        return ret ? true : fail(formula.getErrno());
+    }
+};
+
+#endif
@@ -0,0 +1,363 @@
+/**********************************************************************************[MaxSATSolutionCache.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATSolutionCache_Interface_h
+#define MaxSATSolutionCache_Interface_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "MaxSATInstance.h"
+
+/** Class to remember optimal models of formulas that are solved repeatedly
+ *
+ *  Formulas are identified by fingerprints that do not depend on the names
+ *  of the variables. Variables are colored by their occurrences in clauses
+ *  and at-most-k constraints, and the colors are refined a few times with
+ *  the colors of their neighbors. Sorting the variables by color gives a
+ *  canonical numbering, and the formula written with this numbering is
+ *  hashed. Models are stored with the canonical numbering, such that they
+ *  can be translated to formulas that differ in the names of the variables.
+ *
+ *  Two fingerprints are computed: one of the whole formula, and one of its
+ *  hard clauses and at-most-k constraints. If the fingerprint of the whole
+ *  formula is known, and the stored canonical form of the formula is equal
+ *  to the one of the given formula, the stored model is returned as optimal
+ *  model (a hit). Otherwise, if a stored model satisfies the hard part of the
+ *  formula, it is a good start assignment and upper bound (a near hit).
+ *
+ *  Note: colors cannot distinguish all variables of symmetric formulas. Then,
+ *  the canonical numbering depends on the given names, and renamed formulas
+ *  are not recognized. Models are checked before they are used, and a hit
+ *  requires equal canonical forms, such that a hash collision cannot result
+ *  in a wrong model, or a model that is wrongly reported as optimal.
+ *
+ *  The cache is bounded in memory, and the least recently used models are
+ *  evicted. All methods can be called from several threads concurrently.
+ */
+class MaxSATSolutionCache {
+
+public:
+
+    /** Fingerprints of a formula, see fingerprint */
+    struct Key {
+        uint64_t formula;
+        uint64_t hard;
+
+        /** canonical number of each variable, for both fingerprints */
+        std::vector<int> formulaOrder;
+        std::vector<int> hardOrder;
+
+        /** sorted constraints of the formula with the canonical numbering */
+        std::vector<uint64_t> formulaForm;
+
+        Key() : formula(0), hard(0) {}
+    };
+
+    /** Result of a lookup */
+    enum Match {
+        MISS = 0,
+        NEAR_HIT = 1,
+        HIT = 2,
+    };
+
+private:
+
+    /** stored model, with values per canonical variable */
+    struct Entry {
+        uint64_t formula;
+        uint64_t hard;
+        std::vector<int> formulaModel;
+        std::vector<int> hardModel;
+        std::vector<uint64_t> formulaForm;
+        uint64_t cost;
+
+        size_t bytes() const
+        {
+            return sizeof(Entry) + (formulaModel.capacity() + hardModel.capacity()) * sizeof(int)
+                   + formulaForm.capacity() * sizeof(uint64_t) + 4 * sizeof(void *);
+        }
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    /** protects all other members */
+    mutable std::mutex lock;
+
+    /** entries, most recently used first */
+    EntryList entries;
+
+    /** entries by fingerprint of the formula, and of the hard part */
+    std::unordered_map<uint64_t, EntryList::iterator> byFormula, byHard;
+
+    size_t maxBytes;
+    size_t usedBytes;
+    uint64_t hits, nearHits, misses;
+
+    /** Explicitly disallow copy constructors */
+    MaxSATSolutionCache(const MaxSATSolutionCache& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    MaxSATSolutionCache& operator=(MaxSATSolutionCache const&) = delete;
+
+    /** Mix a value into a hash */
+    static uint64_t mix(uint64_t hash, uint64_t value)
+    {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        hash ^= hash >> 31;
+        hash *= 0xbf58476d1ce4e5b9ULL;
+        return hash ^ (hash >> 29);
+    }
+
+    /** Hash of a sorted sequence */
+    static uint64_t hashSorted(std::vector<uint64_t> &values, uint64_t seed)
+    {
+        std::sort(values.begin(), values.end());
+        uint64_t hash = seed;
+        for(size_t i = 0; i < values.size(); ++i) hash = mix(hash, values[i]);
+        return mix(hash, values.size());
+    }
+
+    /** Call visit(literals, size, tag) for each constraint of the fingerprint,
+     *  where tag distinguishes hard clauses, weights, and bounds */
+    template<typename Visitor>
+    static void forEachConstraint(const MaxSATInstance &formula, bool withSoftClauses, Visitor visit)
+    {
+        for(size_t i = 0; i < formula.nClauses(); ++i) {
+            if(!withSoftClauses && formula.weight(i) != 0) continue;
+            visit(formula.clause(i), formula.clauseSize(i), mix(1, formula.weight(i)));
+        }
+        for(size_t i = 0; i < formula.nAtMostK(); ++i)
+            visit(formula.atMostK(i), formula.atMostKSize(i), mix(2, formula.atMostKBound(i)));
+    }
+
+    /** Canonical code of a literal */
+    static uint64_t canonicalLiteral(const std::vector<int> &order, int literal)
+    {
+        return literal > 0 ? 2 * (uint64_t)order[literal] : 2 * (uint64_t)order[-literal] + 1;
+    }
+
+    /** Write the formula with the canonical numbering, as sorted sequence of
+     *  constraints, each given by its tag, its size, and its sorted literals */
+    static void canonicalForm(const MaxSATInstance &formula, const std::vector<int> &order, std::vector<uint64_t> &form)
+    {
+        std::vector<std::vector<uint64_t> > constraints;
+        forEachConstraint(formula, true, [&](const int *lits, size_t size, uint64_t tag) {
+            std::vector<uint64_t> constraint(2, tag);
+            constraint[1] = size;
+            for(size_t j = 0; j < size; ++j) constraint.push_back(canonicalLiteral(order, lits[j]));
+            std::sort(constraint.begin() + 2, constraint.end());
+            constraints.push_back(std::move(constraint));
+        });
+        std::sort(constraints.begin(), constraints.end());
+        form.assign(1, formula.nVars());
+        for(size_t i = 0; i < constraints.size(); ++i) form.insert(form.end(), constraints[i].begin(), constraints[i].end());
+    }
+
+    /** Compute the canonical numbering of the variables, and the hash of the
+     *  formula with this numbering */
+    static uint64_t canonicalHash(const MaxSATInstance &formula, bool withSoftClauses, std::vector<int> &order)
+    {
+        const int nVars = formula.nVars();
+        std::vector<uint64_t> colors(nVars + 1, 1), next(nVars + 1);
+        std::vector<std::vector<uint64_t> > occurrences(nVars + 1);
+        std::vector<uint64_t> literals;
+
+        // the color of a constraint is the multiset of its literal colors
+        const int rounds = 3;
+        for(int round = 0; round < rounds; ++round) {
+            for(int v = 0; v <= nVars; ++v) occurrences[v].clear();
+            forEachConstraint(formula, withSoftClauses, [&](const int *lits, size_t size, uint64_t tag) {
+                literals.clear();
+                for(size_t j = 0; j < size; ++j) literals.push_back(mix(colors[std::abs(lits[j])], lits[j] > 0));
+                const uint64_t color = hashSorted(literals, tag);
+                for(size_t j = 0; j < size; ++j) occurrences[std::abs(lits[j])].push_back(mix(color, lits[j] > 0));
+            });
+            for(int v = 1; v <= nVars; ++v) next[v] = hashSorted(occurrences[v], colors[v]);
+            colors.swap(next);
+        }
+
+        std::vector<std::pair<uint64_t, int> > sorted;
+        for(int v = 1; v <= nVars; ++v) sorted.push_back(std::make_pair(colors[v], v));
+        std::sort(sorted.begin(), sorted.end());
+        order.assign(nVars + 1, 0);
+        for(int i = 0; i < nVars; ++i) order[sorted[i].second] = i + 1;
+
+        std::vector<uint64_t> constraints;
+        forEachConstraint(formula, withSoftClauses, [&](const int *lits, size_t size, uint64_t tag) {
+            literals.clear();
+            for(size_t j = 0; j < size; ++j) literals.push_back(canonicalLiteral(order, lits[j]));
+            constraints.push_back(hashSorted(literals, tag));
+        });
+        return hashSorted(constraints, mix(3, nVars));
+    }
+
+    /** Store the values of a model per canonical variable */
+    static void toCanonical(const std::vector<int> &model, const std::vector<int> &order, std::vector<int> &canonical)
+    {
+        canonical.assign(order.size(), 0);
+        for(size_t v = 1; v < order.size(); ++v) canonical[order[v]] = MaxSATInstance::isTrue(model, v) ? 1 : -1;
+    }
+
+    /** Translate a model per canonical variable to the given formula */
+    static void fromCanonical(const std::vector<int> &canonical, const std::vector<int> &order, std::vector<int> &model)
+    {
+        model.assign(order.size(), 0);
+        for(size_t v = 1; v < order.size(); ++v) model[v] = canonical[order[v]] > 0 ? (int)v : -(int)v;
+    }
+
+    /** Move an entry to the front of the list */
+    void touch(EntryList::iterator entry) { entries.splice(entries.begin(), entries, entry); }
+
+    /** Remove an entry, and its references */
+    void erase(EntryList::iterator entry)
+    {
+        std::unordered_map<uint64_t, EntryList::iterator>::iterator it = byFormula.find(entry->formula);
+        if(it != byFormula.end() && it->second == entry) byFormula.erase(it);
+        it = byHard.find(entry->hard);
+        if(it != byHard.end() && it->second == entry) byHard.erase(it);
+        usedBytes -= entry->bytes();
+        entries.erase(entry);
+    }
+
+public:
+
+    /** Create an empty cache
+     *
+     *  @param bytes memory limit for the stored models
+     */
+    MaxSATSolutionCache(size_t bytes = 64 * 1024 * 1024)
+    : maxBytes(bytes), usedBytes(0), hits(0), nearHits(0), misses(0)
+    {}
+
+    /** Compute the fingerprints and the canonical form of a formula
+     *
+     *  The effort is linear in the size of the formula, up to sorting.
+     */
+    static void fingerprint(const MaxSATInstance &formula, Key &key)
+    {
+        key.formula = canonicalHash(formula, true, key.formulaOrder);
+        key.hard = canonicalHash(formula, false, key.hardOrder);
+        canonicalForm(formula, key.formulaOrder, key.formulaForm);
+    }
+
+    /** Look up a stored model for the given formula
+     *
+     *  @param key fingerprints and canonical form of formula
+     *  @param model stores the model in case of a (near) hit
+     *  @param cost stores the cost of model on formula in case of a (near) hit
+     *  @return HIT, if model is an optimal model of formula
+     *          NEAR_HIT, if model satisfies the hard part of formula
+     *          MISS, otherwise
+     */
+    Match lookup(const MaxSATInstance &formula, const Key &key, std::vector<int> &model, uint64_t &cost)
+    {
+        std::vector<int> canonical;
+        uint64_t storedCost = UINT64_MAX;
+        Match match = MISS;
+        bool formulaModel = false;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            std::unordered_map<uint64_t, EntryList::iterator>::iterator it = byFormula.find(key.formula);
+            if(it != byFormula.end()) {
+                // on a hash collision, the model might still satisfy the hard part
+                match = it->second->formulaForm == key.formulaForm ? HIT : NEAR_HIT;
+                formulaModel = true;
+                canonical = it->second->formulaModel;
+                storedCost = it->second->cost;
+                touch(it->second);
+            } else if((it = byHard.find(key.hard)) != byHard.end()) {
+                match = NEAR_HIT;
+                canonical = it->second->hardModel;
+                touch(it->second);
+            }
+        }
+
+        // check the model outside the lock, as it is linear in the formula
+        if(match != MISS && canonical.size() == key.formulaOrder.size()) {
+            fromCanonical(canonical, formulaModel ? key.formulaOrder : key.hardOrder, model);
+            if(!formula.computeCost(model, cost)) match = MISS;
+            else if(match == HIT && cost != storedCost) match = NEAR_HIT;
+        } else {
+            match = MISS;
+        }
+        if(match == MISS) model.clear();
+
+        std::unique_lock<std::mutex> guard(lock);
+        if(match == HIT) hits++;
+        else if(match == NEAR_HIT) nearHits++;
+        else misses++;
+        return match;
+    }
+
+    /** Store an optimal model of the formula with the given fingerprints
+     *
+     *  @return false, if the model does not fit into the cache
+     */
+    bool store(const Key &key, const std::vector<int> &model, uint64_t cost)
+    {
+        Entry entry;
+        try {
+            entry.formula = key.formula;
+            entry.hard = key.hard;
+            entry.cost = cost;
+            toCanonical(model, key.formulaOrder, entry.formulaModel);
+            toCanonical(model, key.hardOrder, entry.hardModel);
+            entry.formulaForm = key.formulaForm;
+        } catch (std::exception &e) {
+            return false;
+        }
+        const size_t bytes = entry.bytes();
+        if(bytes > maxBytes) return false;
+
+        std::unique_lock<std::mutex> guard(lock);
+        std::unordered_map<uint64_t, EntryList::iterator>::iterator it = byFormula.find(key.formula);
+        if(it != byFormula.end()) erase(it->second);
+        while(!entries.empty() && usedBytes + bytes > maxBytes) erase(--entries.end());
+        try {
+            entries.push_front(std::move(entry));
+        } catch (std::exception &e) {
+            return false;
+        }
+        usedBytes += bytes;
+        try {
+            byFormula[key.formula] = entries.begin();
+            byHard[key.hard] = entries.begin();
+        } catch (std::exception &e) {
+            erase(entries.begin());
+            return false;
+        }
+        return true;
+    }
+
+    /** Number of stored models */
+    size_t size() const
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        return entries.size();
+    }
+
+    /** Memory of the stored models, in bytes */
+    size_t memoryUsage() const
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        return usedBytes;
+    }
+
+    /** Number of lookups per result */
+    uint64_t getHits() const { std::unique_lock<std::mutex> guard(lock); return hits; }
+    uint64_t getNearHits() const { std::unique_lock<std::mutex> guard(lock); return nearHits; }
+    uint64_t getMisses() const { std::unique_lock<std::mutex> guard(lock); return misses; }
+};
+
+#endif
@@ -0,0 +1,169 @@
+/**********************************************************************************[MaxSATSolverPool.h]
+
+Copyright (c) 2019, Norbert Manthey, all rights reserved.
+
+**************************************************************************************************/
+
+#ifndef MaxSATSolverPool_Interface_h
+#define MaxSATSolverPool_Interface_h
+
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "IncrementalMaxSATSolver.h"
+
+/** Class to reuse solvers for many independent formulas
+ *
+ *  Idle solvers are kept per size class, i.e. the number of variables rounded
+ *  up to the next power of two. A solver that is handed out has been reset,
+ *  such that it does not know any constraint, only accepts the requested
+ *  variables, and uses the default configuration. Solvers that are returned to the pool keep the memory of their
+ *  formulas, so that solving many small formulas does not allocate and free
+ *  this memory for each formula. All methods can be called from several
+ *  threads concurrently.
+ *
+ *  Note: the backend cannot be reused after compute_maxsat, hence each call
+ *  to compute_maxsat of a pooled solver still creates a fresh backend.
+ */
+class MaxSATSolverPool {
+
+    /** protects idle and handedOut */
+    mutable std::mutex lock;
+
+    /** solvers that can be handed out, per size class */
+    std::map<int, std::vector<std::unique_ptr<IncrementalMaxSATSolver> > > idle;
+
+    /** size class of the solvers that are handed out, as auxiliary variables
+     *  of encodings increase the number of variables of their formulas */
+    std::map<const IncrementalMaxSATSolver *, int> handedOut;
+
+    /** maximal number of idle solvers per size class */
+    size_t maxIdle;
+
+    /** Explicitly disallow copy constructors */
+    MaxSATSolverPool(const MaxSATSolverPool& other) = delete;
+
+    /** Explicitly disallow copy operator */
+    MaxSATSolverPool& operator=(MaxSATSolverPool const&) = delete;
+
+    /** Size class of a formula with the given variables */
+    static int sizeClass(int nVars)
+    {
+        int size = 16;
+        while(size < nVars && size < (1 << 30)) size *= 2;
+        return size;
+    }
+
+    /** Create a solver for the given size class, or return 0 */
+    static IncrementalMaxSATSolver *create(int size)
+    {
+        try {
+            return new IncrementalMaxSATSolver(size, 4 * size);
+        } catch (std::exception &e) {
+            return 0;
+        }
+    }
+
+public:
+
+    /** Create an empty pool
+     *
+     *  @param maxIdlePerClass number of idle solvers that are kept per size
+     *         class, further returned solvers are freed
+     */
+    MaxSATSolverPool(size_t maxIdlePerClass = 64) : maxIdle(maxIdlePerClass) {}
+
+    /** Create solvers for formulas with the given variables in advance
+     *
+     *  @return number of solvers that have been added to the pool
+     */
+    size_t prepare(int nVars, size_t count)
+    {
+        const int size = sizeClass(nVars);
+        size_t added = 0;
+        for(; added < count; ++added) {
+            std::unique_ptr<IncrementalMaxSATSolver> solver(create(size));
+            if(!solver) break;
+            std::unique_lock<std::mutex> guard(lock);
+            std::vector<std::unique_ptr<IncrementalMaxSATSolver> > &solvers = idle[size];
+            if(solvers.size() >= maxIdle) break;
+            solvers.push_back(std::move(solver));
+        }
+        return added;
+    }
+
+    /** Hand out a solver for a formula over the variables 1 to nVars
+     *
+     *  The solver is taken from the pool, if possible, and created otherwise.
+     *
+     *  @return the solver, or an empty pointer, if it cannot be created
+     */
+    std::unique_ptr<IncrementalMaxSATSolver> acquire(int nVars)
+    {
+        const int size = sizeClass(nVars);
+        std::unique_ptr<IncrementalMaxSATSolver> solver;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            std::vector<std::unique_ptr<IncrementalMaxSATSolver> > &solvers = idle[size];
+            if(!solvers.empty()) {
+                solver = std::move(solvers.back());
+                solvers.pop_back();
+            }
+        }
+        if(!solver) solver.reset(create(size));
+        if(!solver) return solver;
+        solver->reset(nVars);
+        try {
+            std::unique_lock<std::mutex> guard(lock);
+            handedOut[solver.get()] = size;
+        } catch (std::exception &e) {
+            // release falls back to the size of the formula
+        }
+        return solver;
+    }
+
+    /** Return a solver to the pool, so that it can be handed out again
+     *
+     *  The solver is returned to the size class it was handed out for. The
+     *  solver does not have to be acquired from this pool, then the size
+     *  class is selected by the variables of its formula. Its configuration is
+     *  set to the defaults, so that e.g. a solution cache that is not alive
+     *  anymore is not passed on.
+     */
+    void release(std::unique_ptr<IncrementalMaxSATSolver> solver)
+    {
+        if(!solver) return;
+        int size = 0;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            std::map<const IncrementalMaxSATSolver *, int>::iterator it = handedOut.find(solver.get());
+            if(it != handedOut.end()) {
+                size = it->second;
+                handedOut.erase(it);
+            }
+        }
+        if(size == 0) size = sizeClass(solver->getFormula().nVars());
+        // drop the formula early, its memory is kept
+        solver->reset(size, true);
+        std::unique_lock<std::mutex> guard(lock);
+        std::vector<std::unique_ptr<IncrementalMaxSATSolver> > &solvers = idle[size];
+        if(solvers.size() < maxIdle) solvers.push_back(std::move(solver));
+    }
+
+    /** Number of solvers that are currently kept in the pool */
+    size_t idleSolvers() const
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        size_t count = 0;
+        for(std::map<int, std::vector<std::unique_ptr<IncrementalMaxSATSolver> > >::const_iterator it = idle.begin();
+            it != idle.end(); ++it)
+            count += it->second.size();
+        return count;
+    }
+};
+
+#endif
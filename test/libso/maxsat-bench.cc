@@ -0,0 +1,350 @@
+/* Norbert Manthey, Copyright 2019, All rights reserved
+ *
+ * This file measures the performance of the MaxSATSolver interface on a set
+ * of WCNF files and generated formula families, prints the measurements as
+ * JSON, and compares them against a stored baseline.
+ *
+ * Usage: maxsat-bench [options] [files]
+ *   --repeat N        solve each formula N times, and report the median times
+ *   --scale N         size factor of the generated families, 0 disables them
+ *   --local-search N  run N local search flips before the backend
+ *   --output FILE     write the JSON report to FILE instead of stdout, which
+ *                     is preferable, as the backend prints to stdout as well
+ *   --baseline FILE   compare against a JSON report of an earlier run
+ *   --tolerance X     report a regression, if a time exceeds X times the
+ *                     baseline, plus 5 milliseconds
+ *
+ * Each formula is solved until the backend finishes, as the backend cannot be
+ * interrupted: a time limit would only stop waiting, while the destructor of
+ * AnytimeMaxSATSolver still blocks until the search ends.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "include/MaxSATSolver.h"
+#include "include/AnytimeMaxSATSolver.h"
+#include "include/MaxSATInstance.h"
+#include "include/MaxSATReader.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/** Measurements of a single formula */
+struct Measurement {
+  string name;
+  int variables;
+  size_t clauses;
+  size_t atMostK;
+  string status;
+  uint64_t cost;
+  double constructionMs;
+  double firstModelMs;
+  double optimumMs;
+  long peakRssKb;
+
+  Measurement() : variables(0), clauses(0), atMostK(0), cost(0), constructionMs(0), firstModelMs(-1), optimumMs(-1), peakRssKb(0) {}
+};
+
+static double millisecondsSince(Clock::time_point start)
+{
+  return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+static double median(vector<double> values)
+{
+  if(values.empty()) return -1;
+  sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+static const char *statusName(MaxSATSolver::ReturnCode status)
+{
+  switch(status) {
+    case MaxSATSolver::SATISFIABLE: return "SATISFIABLE";
+    case MaxSATSolver::UNSATISFIABLE: return "UNSATISFIABLE";
+    case MaxSATSolver::OPTIMAL: return "OPTIMAL";
+    case MaxSATSolver::ERROR: return "ERROR";
+    default: return "UNKNOWN";
+  }
+}
+
+/** The formulas of amktest_full, scaled to total variables: exactly half of
+ *  the variables are true, and variable i costs i if it is true, or 1 for
+ *  uniform weights */
+static MaxSATInstance amkFamily(int total, bool uniform)
+{
+  MaxSATInstance formula(total, 2 * total);
+  vector<int> lits;
+  for(int l = 1; l <= total; ++ l) lits.push_back(l);
+  formula.addAtMostK(lits, total / 2);
+  for(int l = 1; l <= total; ++ l) lits[l - 1] = -l;
+  formula.addAtMostK(lits, total - total / 2);
+  for(int l = 1; l <= total; ++ l) formula.addClause({-l}, uniform ? 1 : l);
+  return formula;
+}
+
+/** Place pigeons into one fewer holes, where pigeon p costs p + 1 if it is
+ *  not placed, hence the optimum is 1 */
+static MaxSATInstance pigeonFamily(int holes)
+{
+  const int pigeons = holes + 1;
+  MaxSATInstance formula(pigeons * holes, pigeons + holes);
+  for(int p = 0; p < pigeons; ++ p) {
+    vector<int> clause;
+    for(int h = 0; h < holes; ++ h) clause.push_back(p * holes + h + 1);
+    formula.addClause(clause, p + 1);
+  }
+  for(int h = 0; h < holes; ++ h) {
+    vector<int> lits;
+    for(int p = 0; p < pigeons; ++ p) lits.push_back(p * holes + h + 1);
+    formula.addAtMostK(lits, 1);
+  }
+  return formula;
+}
+
+/** Measure a formula, repeating the measurement, and reporting the median */
+static Measurement measure(const string &name, const MaxSATInstance &formula, int repeat, uint64_t localSearchFlips)
+{
+  Measurement result;
+  result.name = name;
+  result.variables = formula.nVars();
+  result.clauses = formula.nClauses();
+  result.atMostK = formula.nAtMostK();
+
+  vector<double> construction, firstModel, optimum;
+  for(int r = 0; r < repeat; ++ r) {
+    Clock::time_point start = Clock::now();
+    {
+      MaxSATSolver solver(formula.nVars(), formula.nClauses());
+      formula.loadInto(solver);
+      construction.push_back(millisecondsSince(start));
+    }
+
+    AnytimeMaxSATSolver anytime(formula);
+    anytime.setLocalSearch(localSearchFlips);
+    double first = -1;
+    start = Clock::now();
+    anytime.setCallback([&](const vector<int> &model, uint64_t cost, uint64_t lowerBound) {
+      if(first < 0) first = millisecondsSince(start);
+      return true;
+    });
+    vector<int> model;
+    uint64_t cost = 0;
+    MaxSATSolver::ReturnCode ret = anytime.compute_maxsat(model, cost);
+    const double total = millisecondsSince(start);
+    if(first >= 0) firstModel.push_back(first);
+    if(ret == MaxSATSolver::OPTIMAL || ret == MaxSATSolver::UNSATISFIABLE) optimum.push_back(total);
+    result.status = statusName(ret);
+    result.cost = model.empty() ? 0 : cost;
+  }
+  cerr << "c measured " << name << ": " << result.status << " with cost " << result.cost << endl;
+  result.constructionMs = median(construction);
+  result.firstModelMs = median(firstModel);
+  result.optimumMs = median(optimum);
+
+  // the peak of the process so far, as there is no peak per formula
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  result.peakRssKb = usage.ru_maxrss;
+  return result;
+}
+
+/** Escape a string for a JSON string literal */
+static string escapeJSON(const string &text)
+{
+  string escaped;
+  for(size_t i = 0; i < text.size(); ++ i) {
+    const unsigned char c = text[i];
+    if(c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if(c < 0x20) {
+      char code[7];
+      snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+/** Print the measurements as JSON, with one formula per line */
+static void printJSON(ostream &out, const vector<Measurement> &results)
+{
+  MaxSATSolver solver(1, 0);
+  out << "{\n  \"solver\": \"" << solver.getSolverName() << "\",\n  \"version\": " << solver.getVersion()
+      << ",\n  \"instances\": [\n";
+  for(size_t i = 0; i < results.size(); ++ i) {
+    const Measurement &m = results[i];
+    out << "    {\"name\": \"" << escapeJSON(m.name) << "\", \"variables\": " << m.variables << ", \"clauses\": " << m.clauses
+        << ", \"atmostk\": " << m.atMostK << ", \"status\": \"" << m.status << "\", \"cost\": " << m.cost
+        << ", \"construction_ms\": " << m.constructionMs << ", \"first_model_ms\": " << m.firstModelMs
+        << ", \"optimum_ms\": " << m.optimumMs << ", \"peak_rss_kb\": " << m.peakRssKb << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+/** Extract the value of a field from a line of printJSON, where strings are
+ *  unescaped
+ *
+ *  Quotes inside of strings are escaped, hence the pattern cannot match
+ *  inside of the name.
+ */
+static string field(const string &line, const string &key)
+{
+  const string pattern = "\"" + key + "\": ";
+  size_t pos = line.find(pattern);
+  if(pos == string::npos) return "";
+  pos += pattern.size();
+  if(line[pos] != '"') return line.substr(pos, line.find_first_of(",}", pos) - pos);
+
+  string value;
+  for(++ pos; pos < line.size() && line[pos] != '"'; ++ pos) {
+    if(line[pos] != '\\' || pos + 1 == line.size()) {
+      value += line[pos];
+      continue;
+    }
+    const char c = line[++ pos];
+    if(c == 'u' && pos + 4 < line.size()) {
+      value += (char)strtol(line.substr(pos + 1, 4).c_str(), 0, 16);
+      pos += 4;
+    } else {
+      value += c;
+    }
+  }
+  return value;
+}
+
+/** Read a report of printJSON, indexed by formula name */
+static bool readBaseline(const char *filename, map<string, Measurement> &baseline)
+{
+  ifstream in(filename);
+  if(!in) return false;
+  string line;
+  while(getline(in, line)) {
+    Measurement m;
+    m.name = field(line, "name");
+    if(m.name.empty()) continue;
+    m.status = field(line, "status");
+    m.cost = strtoull(field(line, "cost").c_str(), 0, 10);
+    m.constructionMs = atof(field(line, "construction_ms").c_str());
+    m.firstModelMs = atof(field(line, "first_model_ms").c_str());
+    m.optimumMs = atof(field(line, "optimum_ms").c_str());
+    baseline[m.name] = m;
+  }
+  return true;
+}
+
+/** Check whether a time regressed compared to the baseline */
+static bool slower(double current, double base, double tolerance)
+{
+  if(base < 0) return false;
+  return current < 0 || current > base * tolerance + 5;
+}
+
+/** Print the differences to the baseline, and return the number of regressions */
+static int compare(const vector<Measurement> &results, const map<string, Measurement> &baseline, double tolerance)
+{
+  int regressions = 0;
+  for(size_t i = 0; i < results.size(); ++ i) {
+    const Measurement &m = results[i];
+    map<string, Measurement>::const_iterator it = baseline.find(m.name);
+    if(it == baseline.end()) {
+      cerr << "c " << m.name << ": not part of the baseline" << endl;
+      continue;
+    }
+    const Measurement &b = it->second;
+    vector<string> issues;
+    if(m.status != b.status) issues.push_back("status " + b.status + " -> " + m.status);
+    if(m.status == "OPTIMAL" && b.status == "OPTIMAL" && m.cost != b.cost) issues.push_back("different optimum");
+    if(slower(m.constructionMs, b.constructionMs, tolerance)) issues.push_back("construction time");
+    if(slower(m.firstModelMs, b.firstModelMs, tolerance)) issues.push_back("time to first model");
+    if(slower(m.optimumMs, b.optimumMs, tolerance)) issues.push_back("time to optimum");
+    for(size_t j = 0; j < issues.size(); ++ j) cerr << "c " << m.name << ": regression in " << issues[j] << endl;
+    regressions += !issues.empty();
+  }
+  return regressions;
+}
+
+int main(int argc, char **argv)
+{
+  int repeat = 3, scale = 1;
+  uint64_t localSearchFlips = 10000;
+  double tolerance = 1.5;
+  const char *output = 0, *baselineFile = 0;
+  vector<string> files;
+  for(int i = 1; i < argc; ++ i) {
+    const string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if(arg == "--repeat" && hasValue) repeat = max(1, atoi(argv[++ i]));
+    else if(arg == "--scale" && hasValue) scale = max(0, atoi(argv[++ i]));
+    else if(arg == "--local-search" && hasValue) localSearchFlips = strtoull(argv[++ i], 0, 10);
+    else if(arg == "--output" && hasValue) output = argv[++ i];
+    else if(arg == "--baseline" && hasValue) baselineFile = argv[++ i];
+    else if(arg == "--tolerance" && hasValue) tolerance = atof(argv[++ i]);
+    else if(arg.compare(0, 2, "--") == 0) {
+      cerr << "c unknown option " << arg << endl;
+      return 2;
+    } else files.push_back(arg);
+  }
+
+  vector<Measurement> results;
+  for(size_t i = 0; i < files.size(); ++ i) {
+    MaxSATInstance formula;
+    MaxSATReader reader;
+    if(!reader.read(files[i].c_str(), formula)) {
+      cerr << "c failed to read " << files[i] << " in line " << reader.getErrorLine() << " with error " << reader.getErrno() << endl;
+      return 2;
+    }
+    results.push_back(measure(files[i], formula, repeat, localSearchFlips));
+  }
+  // the effort grows quickly with the size, already the second size takes seconds
+  for(int size = 1; size <= scale; ++ size) {
+    stringstream weighted, uniform, pigeons;
+    weighted << "amk-weighted-" << 8 + 4 * size;
+    results.push_back(measure(weighted.str(), amkFamily(8 + 4 * size, false), repeat, localSearchFlips));
+    uniform << "amk-uniform-" << 16 + 8 * size;
+    results.push_back(measure(uniform.str(), amkFamily(16 + 8 * size, true), repeat, localSearchFlips));
+    pigeons << "pigeon-" << 4 + size;
+    results.push_back(measure(pigeons.str(), pigeonFamily(4 + size), repeat, localSearchFlips));
+  }
+
+  if(output) {
+    ofstream out(output);
+    printJSON(out, results);
+    if(!out) {
+      cerr << "c failed to write " << output << endl;
+      return 2;
+    }
+  } else {
+    printJSON(cout, results);
+  }
+
+  if(baselineFile) {
+    map<string, Measurement> baseline;
+    if(!readBaseline(baselineFile, baseline)) {
+      cerr << "c failed to read baseline " << baselineFile << endl;
+      return 2;
+    }
+    const int regressions = compare(results, baseline, tolerance);
+    cerr << "c " << regressions << " formulas regressed compared to " << baselineFile << endl;
+    return regressions == 0 ? 0 : 1;
+  }
+  return 0;
+}
@@ -12,6 +12,17 @@
 #include <sys/resource.h>
 
 #include "include/MaxSATSolver.h"
+#include "include/AnytimeMaxSATSolver.h"
+#include "include/IncrementalMaxSATSolver.h"
+#include "include/LexicographicMaxSATSolver.h"
+#include "include/MaxSATCoreExtractor.h"
+#include "include/MaxSATLocalSearch.h"
+#include "include/MaxSATPortfolio.h"
+#include "include/MaxSATPreprocessor.h"
+#include "include/MaxSATReader.h"
+#include "include/MaxSATSnapshot.h"
+#include "include/MaxSATSolutionCache.h"
+#include "include/MaxSATSolverPool.h"
 
 using namespace std;
 
@@ -477,6 +488,1177 @@ void maxsat_2_test ()
   }
 }
 
+/** Add a formula similar to amktest to a MaxSATInstance or an
+ *  IncrementalMaxSATSolver: at most 5 of 12 variables are true, and the i-th
+ *  variable costs 13 - i if it is false, hence the optimum is 28. The i-th
+ *  variable is first + (i - 1) * step.
+ *
+ *  @return false, if a constraint could not be added
+ */
+template<typename Formula>
+bool addAtMostFiveOfTwelve(Formula &formula, int first = 1, int step = 1)
+{
+  vector<int> lits;
+  for(int i = 0; i < 12; ++ i) lits.push_back(first + i * step);
+  bool added = formula.addAtMostK(lits, 5);
+  for(int i = 0; i < 12; ++ i)
+    added = formula.addClause({lits[i]}, 12 - i) && added;
+  return added;
+}
+
+void incrementaltest ()
+{
+  cout << "run incremental test ..." << endl;
+  IncrementalMaxSATSolver maxsat(12, 0);
+  addAtMostFiveOfTwelve(maxsat);
+
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+  cout << "first cost: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == 28);
+
+  // no model is below a bound under the optimum
+  ret = maxsat.compute_maxsat(model, cost, 20);
+  assert(ret == MaxSATSolver::ReturnCode::UNKNOWN);
+  assert(model.empty() && cost == UINT64_MAX);
+
+  // a soft clause that is satisfied by the optimum does not change the result
+  maxsat.addClause({1, 2}, 100);
+  ret = maxsat.compute_maxsat(model, cost);
+  cout << "second cost: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == 28);
+
+  // forbid the most valuable variable, the next variable has to be used
+  maxsat.addClause({-1});
+  ret = maxsat.compute_maxsat(model, cost);
+  cout << "third cost: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(model[1] < 0 && model[6] > 0);
+  assert(cost == 12 + 28 - 7);
+
+  // conflicting hard clauses make the formula unsatisfiable
+  maxsat.addClause({1});
+  ret = maxsat.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  assert(model.empty());
+}
+
+void assumptiontest ()
+{
+  cout << "run assumption test ..." << endl;
+  IncrementalMaxSATSolver maxsat(4, 0);
+  maxsat.addClause({-1, -2});
+  maxsat.addClause({-2, -3});
+  maxsat.addClause({1}, 3);
+  maxsat.addClause({3}, 2);
+
+  std::vector<int> model, conflict;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat({2}, model, cost, &conflict);
+  cout << "cost with assumption 2: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(model[2] > 0 && cost == 5);
+
+  // assumptions do not remain in the formula
+  ret = maxsat.compute_maxsat(model, cost);
+  cout << "cost without assumptions: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == 0);
+
+  // only the assumptions 1 and 2 are responsible for the conflict
+  ret = maxsat.compute_maxsat({4, 1, -3, 2}, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  cout << "conflict size: " << conflict.size() << endl;
+  assert(conflict.size() == 2 && conflict[0] == 1 && conflict[1] == 2);
+
+  ret = maxsat.compute_maxsat({5}, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::ERROR);
+  assert(maxsat.getErrno() == -EINVAL);
+}
+
+void portfoliotest ()
+{
+  cout << "run portfolio test ..." << endl;
+  MaxSATInstance formula(12, 0);
+  addAtMostFiveOfTwelve(formula);
+
+  MaxSATPortfolio portfolio(4);
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = portfolio.compute_maxsat(formula, model, cost);
+  cout << "portfolio cost: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == 28);
+  uint64_t modelCost = 0;
+  bool valid = formula.computeCost(model, modelCost);
+  assert(valid && modelCost == cost);
+
+  // repeated calls do not wait for the workers of previous calls
+  for(int call = 0; call < 8; ++ call) {
+    ret = portfolio.compute_maxsat(formula, model, cost);
+    assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 28);
+  }
+
+  formula.addClause({1});
+  formula.addClause({-1});
+  ret = portfolio.compute_maxsat(formula, model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+}
+
+void componenttest ()
+{
+  cout << "run component test ..." << endl;
+  MaxSATInstance formula(25, 0);
+  for(int offset = 0; offset <= 12; offset += 12)
+    addAtMostFiveOfTwelve(formula, offset + 1);
+
+  std::vector<MaxSATInstance> parts;
+  std::vector<std::vector<int> > variables;
+  formula.splitComponents(parts, variables);
+  assert(parts.size() == 2 && variables[1][0] == 13);
+
+  MaxSATPortfolio portfolio(2);
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = portfolio.compute_maxsat_components(formula, model, cost);
+  cout << "component cost: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == 56);
+  assert(model.size() == 26 && model[25] == -25);
+  uint64_t modelCost = 0;
+  const bool valid = formula.computeCost(model, modelCost);
+  assert(valid && modelCost == cost);
+}
+
+void batchtest ()
+{
+  cout << "run batch test ..." << endl;
+  // the instances of amktest_full, an unsatisfiable, and an empty formula
+  std::vector<MaxSATInstance> formulas;
+  std::vector<uint64_t> expected;
+  for(int total = 2; total < 12; ++ total) {
+    for(int positive = 1; positive + 1 < total; ++ positive) {
+      MaxSATInstance formula(total, 0);
+      vector<int> lits;
+      for(int l = 1; l <= total; ++ l) lits.push_back(l);
+      formula.addAtMostK(lits, positive);
+      for(int l = 1; l <= total; ++ l) lits[l - 1] = -l;
+      formula.addAtMostK(lits, total - positive);
+      for(int l = 1; l <= total; ++ l) formula.addClause({-l}, l);
+      formulas.push_back(formula);
+      expected.push_back((positive * (positive + 1)) / 2);
+    }
+  }
+  formulas.push_back(MaxSATInstance(1, 0));
+  formulas.back().addClause({1});
+  formulas.back().addClause({-1});
+  formulas.push_back(MaxSATInstance(2, 0));
+
+  MaxSATPortfolio portfolio(4);
+  std::vector<MaxSATPortfolio::BatchResult> results;
+  bool solved = portfolio.compute_maxsat_batch(formulas, results);
+  assert(solved && results.size() == formulas.size());
+  for(size_t i = 0; i < expected.size(); ++ i) {
+    assert(results[i].status == MaxSATSolver::ReturnCode::OPTIMAL && results[i].cost == expected[i]);
+    uint64_t modelCost = 0;
+    const bool valid = formulas[i].computeCost(results[i].model, modelCost);
+    assert(valid && modelCost == expected[i]);
+  }
+  assert(results[expected.size()].status == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  assert(results.back().status == MaxSATSolver::ReturnCode::OPTIMAL && results.back().model.size() == 3);
+
+  // results are overwritten by the next batch
+  formulas.resize(1);
+  solved = portfolio.compute_maxsat_batch(formulas, results);
+  assert(solved && results.size() == 1);
+  assert(results[0].status == MaxSATSolver::ReturnCode::OPTIMAL && results[0].cost == expected[0]);
+}
+
+void anytimetest ()
+{
+  cout << "run anytime test ..." << endl;
+  MaxSATInstance formula(12, 0);
+  addAtMostFiveOfTwelve(formula);
+
+  // the start assignment uses the least valuable variables
+  std::vector<int> start = {0, -1, -2, -3, -4, -5, -6, -7, 8, 9, 10, 11, 12};
+  std::vector<uint64_t> reported;
+  for(int iteration = 0; iteration < 2; ++ iteration)
+  {
+    AnytimeMaxSATSolver maxsat(formula);
+    reported.clear();
+    maxsat.setCallback([&](const std::vector<int> &model, uint64_t cost, uint64_t lowerBound) {
+      cout << "reported model with cost " << cost << " and lower bound " << lowerBound << endl;
+      reported.push_back(cost);
+      return iteration == 0;
+    });
+
+    std::vector<int> model;
+    uint64_t cost = 0;
+    MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost, &start);
+    if(iteration == 0) {
+      assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+      assert(reported.size() == 2 && reported[0] == 63 && reported[1] == 28);
+      assert(cost == 28);
+    } else {
+      // the callback stopped the search after the first model
+      assert(ret == MaxSATSolver::ReturnCode::SATISFIABLE);
+      assert(reported.size() == 1 && cost == 63);
+    }
+  }
+}
+
+void timelimittest ()
+{
+  cout << "run time limit test ..." << endl;
+  MaxSATInstance formula(12, 0);
+  addAtMostFiveOfTwelve(formula);
+  std::vector<int> start = {0, -1, -2, -3, -4, -5, -6, -7, 8, 9, 10, 11, 12};
+
+  // without time, only the start assignment can be reported
+  {
+    AnytimeMaxSATSolver maxsat(formula);
+    maxsat.setTimeLimit(0);
+    std::vector<int> model;
+    uint64_t cost = 0;
+    MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost, &start);
+    cout << "cost with time limit 0: " << cost << endl;
+    assert(ret == MaxSATSolver::ReturnCode::SATISFIABLE || ret == MaxSATSolver::ReturnCode::OPTIMAL);
+    assert(ret == MaxSATSolver::ReturnCode::OPTIMAL || cost == 63);
+  }
+
+  // interrupting before the search waits returns without a model
+  {
+    AnytimeMaxSATSolver maxsat(formula);
+    const bool started = maxsat.start ();
+    assert(started);
+    maxsat.interrupt ();
+    assert(maxsat.done ());
+    std::vector<int> model;
+    uint64_t cost = 0;
+    MaxSATSolver::ReturnCode ret = maxsat.wait(model, cost);
+    assert(ret == MaxSATSolver::ReturnCode::UNKNOWN || ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  }
+
+  // a generous limit does not change the result
+  {
+    AnytimeMaxSATSolver maxsat(formula);
+    maxsat.setTimeLimit(60000);
+    std::vector<int> model;
+    uint64_t cost = 0;
+    MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+    assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 28);
+  }
+}
+
+void bulktest ()
+{
+  cout << "run bulk clause test ..." << endl;
+  const int clauses[] = {-1, -2, 0, -2, -3, 0, 1, 0, 3, 0};
+  const uint64_t weights[] = {0, 0, 3, 2};
+
+  MaxSATInstance formula(3, 0);
+  bool added = formula.addClauses(clauses, sizeof(clauses) / sizeof(int), weights);
+  assert(added && formula.nClauses() == 4);
+  assert(formula.clauseSize(1) == 2 && formula.clause(1)[1] == -3);
+  assert(formula.weight(0) == 0 && formula.weight(3) == 2);
+
+  // invalid input is rejected as a whole
+  const int invalid[] = {1, 2, 0, 4, 0};
+  added = formula.addClauses(invalid, sizeof(invalid) / sizeof(int));
+  assert(!added && formula.getErrno() == -EINVAL && formula.nClauses() == 4);
+  const int unterminated[] = {1, 2};
+  added = formula.addClauses(unterminated, sizeof(unterminated) / sizeof(int));
+  assert(!added && formula.getErrno() == -EINVAL && formula.nClauses() == 4);
+
+  MaxSATSolver maxsat(formula.nVars(), formula.nClauses());
+  const bool loaded = formula.loadInto(maxsat);
+  assert(loaded);
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+  cout << "bulk cost: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 0);
+}
+
+void readertest ()
+{
+  cout << "run reader test ..." << endl;
+  MaxSATReader reader;
+  std::vector<int> model;
+  uint64_t cost = 0;
+
+  MaxSATInstance formula;
+  bool read = reader.read("t.wcnf", formula);
+  cout << "read t.wcnf: " << read << " errno: " << reader.getErrno() << endl;
+  assert(read && formula.nVars() == 15 && formula.nClauses() == 28);
+  assert(formula.weight(0) == 1 && formula.weight(4) == 0);
+  {
+    MaxSATSolver maxsat(formula.nVars(), formula.nClauses());
+    const bool loaded = formula.loadInto(maxsat);
+    assert(loaded);
+    MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+    cout << "t.wcnf cost: " << cost << endl;
+    assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  }
+
+  // new format without header line, soft clauses with weight 0 are dropped
+  const char newFormat[] = "c comment\nh -1 -2 0\nh -2 -3 0\n3 1 0\n2 3 0\n0 2 0\n";
+  MaxSATInstance newFormula;
+  read = reader.readBuffer(newFormat, sizeof(newFormat) - 1, newFormula);
+  assert(read && newFormula.nVars() == 3 && newFormula.nClauses() == 4);
+  assert(newFormula.weight(1) == 0 && newFormula.weight(2) == 3);
+
+  // OPB with cardinality constraints
+  const char opb[] = "* #variable= 3 #constraint= 2\nmin: +3 x1 -2 x2 ;\n+1 x1 +1 x2 +1 x3 >= 2 ;\n+2 x1 +2 ~x3 <= 2 ;\n";
+  MaxSATInstance opbFormula;
+  read = reader.readBuffer(opb, sizeof(opb) - 1, opbFormula);
+  cout << "read opb: " << read << " errno: " << reader.getErrno() << endl;
+  assert(read && opbFormula.nVars() == 3 && opbFormula.nClauses() == 2 && opbFormula.nAtMostK() == 2);
+  {
+    MaxSATSolver maxsat(opbFormula.nVars(), opbFormula.nClauses());
+    const bool loaded = opbFormula.loadInto(maxsat);
+    assert(loaded);
+    MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+    cout << "opb cost: " << cost << endl;
+    assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 0);
+    assert(model[1] < 0 && model[2] > 0 && model[3] > 0);
+  }
+
+  // OPB without header, starting with a coefficient like a 2022 WCNF clause
+  const char bareOPB[] = "1 x1 +1 x2 >= 1 ;\n";
+  MaxSATInstance bareFormula;
+  read = reader.readBuffer(bareOPB, sizeof(bareOPB) - 1, bareFormula);
+  assert(read);
+  assert(bareFormula.nVars() >= 2 && bareFormula.nClauses() + bareFormula.nAtMostK() > 0);
+
+  // sums that do not fit into 64 bits are rejected
+  const char overflow[] = "+9223372036854775807 x1 +1 x2 >= 1 ;\n";
+  MaxSATInstance overflowFormula;
+  read = reader.readBuffer(overflow, sizeof(overflow) - 1, overflowFormula);
+  assert(!read && reader.getErrno() == -EINVAL);
+  const char negativeOverflow[] = "-9223372036854775807 x1 -2 x2 <= -9223372036854775807 ;\n";
+  read = reader.readBuffer(negativeOverflow, sizeof(negativeOverflow) - 1, overflowFormula);
+  assert(!read && reader.getErrno() == -EINVAL);
+
+  const char invalid[] = "p wcnf 2 1 10\n1 1 x 0\n";
+  MaxSATInstance invalidFormula;
+  read = reader.readBuffer(invalid, sizeof(invalid) - 1, invalidFormula);
+  assert(!read && reader.getErrno() == -EINVAL && reader.getErrorLine() == 2);
+  read = reader.read("does-not-exist.wcnf", invalidFormula);
+  assert(!read && reader.getErrno() == -ENOENT);
+}
+
+void pbtest ()
+{
+  cout << "run pseudo-Boolean test ..." << endl;
+  const std::vector<int> lits = {1, 2, 3, 4, -5};
+  const std::vector<uint64_t> coefficients = {6, 4, 4, 2, 3};
+  const uint64_t bound = 9;
+
+  MaxSATInstance formula(5, 0);
+  bool added = formula.addPB(lits, coefficients, bound);
+  assert(added && formula.nVars() > 5 && "general constraint requires auxiliary variables");
+  for(int variable = 1; variable <= 5; ++ variable)
+    formula.addClause({variable}, variable + 1);
+
+  // compute the optimum by enumerating all assignments
+  uint64_t best = UINT64_MAX;
+  for(int assignment = 0; assignment < 32; ++ assignment)
+  {
+    uint64_t sum = 0, cost = 0;
+    for(int i = 0; i < 5; ++ i)
+    {
+      const bool value = (assignment >> i) & 1;
+      if((lits[i] > 0) == value) sum += coefficients[i];
+      if(!value) cost += i + 2;
+    }
+    if(sum <= bound && cost < best) best = cost;
+  }
+
+  MaxSATSolver maxsat(formula.nVars(), formula.nClauses());
+  bool loaded = formula.loadInto(maxsat);
+  assert(loaded);
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+  cout << "pb cost: " << cost << " expected: " << best << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == best);
+
+  // equal coefficients after simplification result in an at-most-k constraint
+  MaxSATInstance cardinality(3, 0);
+  added = cardinality.addPB({1, 2, 3, 1, -1}, {2, 4, 4, 4, 2}, 9);
+  assert(added && cardinality.nVars() == 3 && cardinality.nAtMostK() == 1 && cardinality.atMostKBound(0) == 1);
+
+  added = cardinality.addPB({1, 2}, {1}, 1);
+  assert(!added && cardinality.getErrno() == -EINVAL);
+
+  // coefficients close to the limit must not overflow, at most one literal fits
+  MaxSATInstance large(3, 0);
+  added = large.addPB({1, 2, 3}, {(1ULL << 62) + 3, (1ULL << 62) + 2, (1ULL << 62) + 1}, INT64_MAX - 1);
+  assert(added);
+  for(int variable = 1; variable <= 3; ++ variable)
+    large.addClause({variable}, 1);
+  MaxSATSolver largeSolver(large.nVars(), large.nClauses());
+  loaded = large.loadInto(largeSolver);
+  assert(loaded);
+  ret = largeSolver.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 2);
+
+  // long constraints are encoded without deep recursion
+  MaxSATInstance longFormula(200000, 0);
+  std::vector<int> longLits;
+  std::vector<uint64_t> longCoefficients;
+  for(int variable = 1; variable <= 200000; ++ variable) {
+    longLits.push_back(variable);
+    longCoefficients.push_back(variable % 2 ? 3 : 2);
+  }
+  added = longFormula.addPB(longLits, longCoefficients, 5);
+  assert(added && longFormula.nVars() > 200000);
+}
+
+void encodingtest ()
+{
+  cout << "run cardinality encoding test ..." << endl;
+  const vector<int> lits = {1, 2, 3, 4, 5, 6, 7, 8};
+  const MaxSATInstance::CardinalityEncoding encodings[5] = {
+    MaxSATInstance::LIBRARY, MaxSATInstance::AUTOMATIC, MaxSATInstance::PAIRWISE,
+    MaxSATInstance::LADDER, MaxSATInstance::SEQUENTIAL_COUNTER };
+
+  for(int k = 0; k <= 3; ++ k)
+  {
+    for(int e = 0; e < 5; ++ e)
+    {
+      MaxSATInstance formula(8, 0);
+      formula.addAtMostK(lits, k, encodings[e]);
+      for(int variable = 1; variable <= 8; ++ variable)
+        formula.addClause({variable}, variable);
+
+      if(k == 1 && encodings[e] == MaxSATInstance::PAIRWISE)
+        assert(formula.nClauses() == 8 + 28 && formula.nVars() == 8);
+      if(k == 1 && encodings[e] == MaxSATInstance::AUTOMATIC)
+        assert(formula.nClauses() == 8 + 20 && formula.nVars() == 15 && "ladder encoding");
+
+      MaxSATSolver maxsat(formula.nVars(), formula.nClauses());
+      const bool loaded = formula.loadInto(maxsat);
+      assert(loaded);
+      std::vector<int> model;
+      uint64_t cost = 0;
+      MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+      // the k most valuable variables can be true
+      uint64_t expected = 0;
+      for(int variable = 1; variable <= 8 - k; ++ variable) expected += variable;
+      cout << "k: " << k << " encoding: " << e << " cost: " << cost << " expected: " << expected << endl;
+      assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == expected);
+    }
+  }
+}
+
+void preprocesstest ()
+{
+  cout << "run preprocessing test ..." << endl;
+  MaxSATInstance formula(6, 0);
+  formula.addClause({1});                // unit
+  formula.addClause({-1, 2});            // propagates 2
+  formula.addClause({3, 4});
+  formula.addClause({3, 4, 5});          // subsumed
+  formula.addClause({-3, 4, 6});         // strengthened to (4 6)
+  formula.addClause({-2, 5}, 3);         // unit soft clause (5)
+  formula.addClause({5}, 4);             // merged with the above
+  formula.addClause({-1}, 7);            // falsified
+  formula.addClause({-4}, 2);
+  formula.addClause({-6}, 1);
+
+  MaxSATPreprocessor preprocessor;
+  bool simplified = preprocessor.simplify(formula);
+  assert(simplified);
+  const MaxSATInstance &result = preprocessor.getFormula();
+  cout << "simplified clauses: " << result.nClauses() << " fixed cost: " << preprocessor.getFixedCost() << endl;
+  assert(preprocessor.getFixedCost() == 7);
+  assert(preprocessor.getStatistics().fixedVariables == 2);
+  assert(preprocessor.getStatistics().mergedSoftClauses == 1);
+  assert(result.nVars() == formula.nVars());
+  for(size_t i = 0; i < result.nClauses(); ++ i)
+    assert(result.clauseSize(i) != 3 && "subsumed and strengthened clauses");
+
+  IncrementalMaxSATSolver plain(6), simplifying(6);
+  simplifying.setPreprocessing(true);
+  for(size_t i = 0; i < formula.nClauses(); ++ i) {
+    const vector<int> clause(formula.clause(i), formula.clause(i) + formula.clauseSize(i));
+    plain.addClause(clause, formula.weight(i));
+    simplifying.addClause(clause, formula.weight(i));
+  }
+  std::vector<int> model, expectedModel;
+  uint64_t cost = 0, expected = 0;
+  MaxSATSolver::ReturnCode expectedRet = plain.compute_maxsat(expectedModel, expected);
+  MaxSATSolver::ReturnCode ret = simplifying.compute_maxsat(model, cost);
+  cout << "cost: " << cost << " expected: " << expected << endl;
+  assert(expectedRet == MaxSATSolver::ReturnCode::OPTIMAL && ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == expected && model.size() == 7 && model[1] == 1 && model[2] == 2);
+  uint64_t check = 0;
+  const bool valid = formula.computeCost(model, check);
+  assert(valid && check == cost);
+
+  // assumptions are fixed by the preprocessor
+  vector<int> conflict;
+  ret = simplifying.compute_maxsat({-3}, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(model[3] == -3 && model[4] == 4 && cost == 9);
+  ret = simplifying.compute_maxsat({-3, -4}, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  assert(conflict.size() == 2);
+
+  // the preprocessed formula is reused only until the formula changes
+  IncrementalMaxSATSolver cached(2);
+  cached.setPreprocessing(true);
+  cached.addClause({1, 2});
+  cached.addClause({-1}, 1);
+  cached.addClause({-2}, 1);
+  ret = cached.compute_maxsat({-1}, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 1);
+  cached.addClause({-2});
+  ret = cached.compute_maxsat({-1}, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+
+  // the hard clauses are unsatisfiable after propagation
+  simplifying.addClause({-2});
+  ret = simplifying.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+
+  // a long implication chain x_n -> ... -> x_1 -> -x_n is probed in linear time
+  const int chain = 40000;
+  MaxSATInstance implications(chain, 0);
+  for(int variable = 1; variable < chain; ++ variable)
+    implications.addClause({-variable - 1, variable});
+  implications.addClause({-1, -chain});
+  MaxSATPreprocessor probing;
+  probing.setSubsumptionLimit(0);
+  simplified = probing.simplify(implications);
+  assert(simplified);
+  assert(probing.getStatistics().failedLiterals == 1 && probing.getStatistics().fixedVariables == 1);
+  model.assign(chain + 1, 0);
+  probing.extendModel(model);
+  assert(model[chain] == -chain);
+}
+
+void stratificationtest ()
+{
+  cout << "run stratification test ..." << endl;
+  IncrementalMaxSATSolver plain(8), stratified(8);
+  stratified.setStratification(true);
+  const uint64_t weights[4] = {1, 1000, 1000000, 1000000000};
+  for(int variable = 1; variable <= 8; ++ variable) {
+    plain.addClause({variable}, weights[variable % 4] * variable);
+    stratified.addClause({variable}, weights[variable % 4] * variable);
+  }
+  for(int variable = 1; variable < 8; ++ variable) {
+    plain.addClause({-variable, -variable - 1});
+    stratified.addClause({-variable, -variable - 1});
+  }
+  plain.addAtMostK({1, 3, 5, 7}, 1);
+  stratified.addAtMostK({1, 3, 5, 7}, 1);
+
+  std::vector<int> model, expectedModel;
+  uint64_t cost = 0, expected = 0;
+  MaxSATSolver::ReturnCode expectedRet = plain.compute_maxsat(expectedModel, expected);
+  MaxSATSolver::ReturnCode ret = stratified.compute_maxsat(model, cost);
+  cout << "cost: " << cost << " expected: " << expected << endl;
+  assert(expectedRet == MaxSATSolver::ReturnCode::OPTIMAL && ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  uint64_t check = 0;
+  const bool valid = stratified.getFormula().computeCost(model, check);
+  assert(cost == expected && valid && check == cost);
+
+  // levels are solved under the assumptions as well
+  ret = stratified.compute_maxsat({-3}, model, cost);
+  expectedRet = plain.compute_maxsat({-3}, expectedModel, expected);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && expectedRet == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == expected && model[3] == -3);
+}
+
+void lexicographictest ()
+{
+  cout << "run lexicographic test ..." << endl;
+  LexicographicMaxSATSolver solver(4);
+  solver.addAtMostK({1, 2, 3, 4}, 2);
+  // level 0: prefer 1, 2, and 3, scaling level 1 above level 0 would overflow
+  bool added = solver.addSoftClause({1}, 1000000000000000000ULL, 0);
+  added = solver.addSoftClause({2}, 1000000000000000000ULL, 0) && added;
+  added = solver.addSoftClause({3}, 500000000000000000ULL, 0) && added;
+  // level 1: prefer 4, and 3 or 4
+  added = solver.addSoftClause({4}, 500000000000000000ULL, 1) && added;
+  added = solver.addSoftClause({3, 4}, 300000000000000000ULL, 1) && added;
+  assert(added);
+  added = solver.addSoftClause({5}, 1, 1);
+  assert(!added && solver.getErrno() == -EINVAL);
+  added = solver.addSoftClause({4}, 0, 1);
+  assert(!added && solver.getErrno() == -EINVAL);
+  assert(solver.nLevels() == 2);
+
+  std::vector<int> model;
+  std::vector<uint64_t> costs;
+  MaxSATSolver::ReturnCode ret = solver.compute_maxsat(model, costs);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  cout << "level costs: " << costs[0] << " " << costs[1] << endl;
+  assert(costs.size() == 2 && costs[0] == 500000000000000000ULL && costs[1] == 800000000000000000ULL);
+  assert(model.size() == 5 && model[1] == 1 && model[2] == 2 && model[3] == -3 && model[4] == -4);
+
+  solver.addClause({-1});
+  solver.addClause({-2});
+  ret = solver.compute_maxsat(model, costs);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(costs[0] == 2000000000000000000ULL && costs[1] == 0 && model[3] == 3 && model[4] == 4);
+}
+
+void localsearchtest ()
+{
+  cout << "run local search test ..." << endl;
+  MaxSATInstance formula(12, 0);
+  addAtMostFiveOfTwelve(formula);
+  formula.addClause({-1, -2});
+
+  MaxSATLocalSearch localSearch(formula, 1);
+  bool found = localSearch.search(10000);
+  assert(found);
+  uint64_t cost = 0;
+  const bool valid = formula.computeCost(localSearch.getModel(), cost);
+  assert(valid && cost == localSearch.getCost());
+  cout << "local search cost: " << cost << " flips: " << localSearch.getFlips() << endl;
+  assert(cost == 32);
+
+  // assumptions are never flipped
+  const vector<int> assumptions = {-1, -2, -3};
+  found = localSearch.search(10000, 0, &assumptions);
+  assert(found);
+  assert(localSearch.getCost() == 43 && localSearch.getModel()[3] == -3);
+
+  IncrementalMaxSATSolver plain(12), guided(12);
+  guided.setLocalSearch(10000);
+  addAtMostFiveOfTwelve(plain);
+  addAtMostFiveOfTwelve(guided);
+  std::vector<int> model;
+  uint64_t expected = 0;
+  MaxSATSolver::ReturnCode expectedRet = plain.compute_maxsat(model, expected);
+  MaxSATSolver::ReturnCode ret = guided.compute_maxsat(model, cost);
+  assert(expectedRet == MaxSATSolver::ReturnCode::OPTIMAL && ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == expected && cost == 28);
+
+  // the local search reports the first model of the anytime search
+  AnytimeMaxSATSolver anytime(formula);
+  anytime.setLocalSearch(10000);
+  std::vector<uint64_t> reported;
+  anytime.setCallback([&](const std::vector<int> &model, uint64_t cost, uint64_t lowerBound) {
+    reported.push_back(cost);
+    return true;
+  });
+  ret = anytime.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(!reported.empty() && reported[0] == 32 && cost == 32);
+}
+
+void warmstarttest ()
+{
+  cout << "run warm start test ..." << endl;
+  IncrementalMaxSATSolver maxsat(12);
+  maxsat.setWarmStart(true);
+  addAtMostFiveOfTwelve(maxsat);
+
+  // the start assignment violates the at-most-k constraint, and is ignored
+  std::vector<int> start = {0, 1, 2, 3, 4, 5, 6, -7, -8, -9, -10, -11, -12};
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost, UINT64_MAX, &start);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 28);
+
+  // an optimal start assignment bounds the search, and is kept
+  maxsat.addClause({-1, -2}, 1);
+  start = model;
+  ret = maxsat.compute_maxsat(model, cost, UINT64_MAX, &start);
+  cout << "cost with warm start: " << cost << endl;
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 29);
+
+  // a start assignment without cost is returned directly
+  IncrementalMaxSATSolver trivial(3);
+  trivial.setWarmStart(true);
+  trivial.addClause({1, 2});
+  trivial.addClause({-1}, 5);
+  trivial.addClause({3}, 2);
+  start = {0, -1, 2, 3};
+  ret = trivial.compute_maxsat(model, cost, UINT64_MAX, &start);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 0 && model == start);
+}
+
+void conflicttest ()
+{
+  cout << "run conflict minimization test ..." << endl;
+  // assumption 1 enables 5 pigeons in 4 holes, which propagation cannot refute
+  const int pigeons = 5, holes = 4;
+  IncrementalMaxSATSolver maxsat(3 + pigeons * holes);
+  for(int p = 0; p < pigeons; ++ p) {
+    vector<int> clause = {-1};
+    for(int h = 0; h < holes; ++ h) clause.push_back(4 + p * holes + h);
+    maxsat.addClause(clause);
+  }
+  for(int h = 0; h < holes; ++ h)
+    for(int p = 0; p < pigeons; ++ p)
+      for(int q = p + 1; q < pigeons; ++ q)
+        maxsat.addClause({-(4 + p * holes + h), -(4 + q * holes + h)});
+  maxsat.addClause({-2, -3});
+  maxsat.addClause({-2, 3});
+
+  const vector<int> assumptions = {1, 2};
+  std::vector<int> model, conflict;
+  uint64_t cost = 0;
+  maxsat.setConflictMinimization(IncrementalMaxSATSolver::CONFLICT_NONE);
+  MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(assumptions, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE && conflict.size() == 2);
+
+  // propagation refutes assumption 2 alone
+  maxsat.setConflictMinimization(IncrementalMaxSATSolver::CONFLICT_PROPAGATION);
+  ret = maxsat.compute_maxsat(assumptions, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  assert(conflict.size() == 1 && conflict[0] == 2);
+
+  // the backend is required to show that assumption 1 is a conflict on its own
+  maxsat.setConflictMinimization(IncrementalMaxSATSolver::CONFLICT_DESTRUCTIVE, 0);
+  ret = maxsat.compute_maxsat({1, 3}, model, cost, &conflict);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE && conflict.size() == 2);
+  maxsat.setConflictMinimization(IncrementalMaxSATSolver::CONFLICT_DESTRUCTIVE);
+  ret = maxsat.compute_maxsat({1, 3}, model, cost, &conflict);
+  cout << "conflict: " << conflict.size() << endl;
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  assert(conflict.size() == 1 && conflict[0] == 1);
+}
+
+void storagetest ()
+{
+  cout << "run storage test ..." << endl;
+  MaxSATInstance formula(1000, 0);
+  std::vector<int> clause;
+  bool added = true;
+  for(int i = 0; i < 3000; ++ i) {
+    clause.clear();
+    for(int j = 0; j <= i % 4; ++ j) clause.push_back((i * 7 + j * 13) % 1000 + 1);
+    // mix hard and soft clauses, including weights that need all 64 bits
+    const uint64_t weight = i % 3 == 0 ? 0 : (i % 3 == 1 ? i : UINT64_MAX - i);
+    added = formula.addClause(clause, weight) && added;
+  }
+  added = formula.addClause(std::vector<int>(), 5) && added;
+  added = formula.addClause(std::vector<int>()) && added;
+  const int buffer[] = {1, -2, 0, 3, 0};
+  const uint64_t weights[] = {7, 0};
+  added = formula.addClauses(buffer, 5, weights) && added;
+  assert(added);
+
+  assert(formula.nClauses() == 3004);
+  for(int i = 0; i < 3000; ++ i) {
+    assert(formula.clauseSize(i) == (size_t)(i % 4 + 1));
+    assert(formula.clause(i)[0] == (i * 7) % 1000 + 1 && formula.clause(i)[formula.clauseSize(i)] == 0);
+    assert(formula.weight(i) == (i % 3 == 0 ? 0 : (i % 3 == 1 ? (uint64_t)i : UINT64_MAX - i)));
+  }
+  assert(formula.clauseSize(3000) == 0 && formula.weight(3000) == 5);
+  assert(formula.clauseSize(3001) == 0 && formula.weight(3001) == 0);
+  assert(formula.clauseSize(3002) == 2 && formula.weight(3002) == 7);
+  assert(formula.clauseSize(3003) == 1 && formula.weight(3003) == 0);
+
+  // hard clauses do not store a weight
+  cout << "memory usage: " << formula.memoryUsage() << " bytes" << endl;
+  assert(formula.memoryUsage() < 3004 * (sizeof(size_t) + sizeof(uint64_t)) + 10000 * sizeof(int) * 2);
+}
+
+void memorylimittest ()
+{
+  cout << "run memory limit test ..." << endl;
+  MaxSATInstance formula(100, 0);
+  formula.setMemoryLimit(1024);
+  std::vector<int> clause = {1, 2, 3, 4, 5, 6, 7, 8};
+  size_t added = 0;
+  while(formula.addClause(clause)) added ++;
+  cout << "c stopped after adding " << added << " clauses" << endl;
+  assert(formula.getErrno() == -ENOMEM && added > 0 && formula.nClauses() == added);
+
+  // an encoding that does not fit is not kept partially
+  MaxSATInstance encoded(100, 0);
+  encoded.setMemoryLimit(256);
+  std::vector<int> literals;
+  for(int v = 1; v <= 50; ++ v) literals.push_back(v);
+  bool encodedAdded = encoded.addAtMostK(literals, 1, MaxSATInstance::LADDER);
+  assert(!encodedAdded);
+  assert(encoded.getErrno() == -ENOMEM && encoded.nClauses() == 0 && encoded.nVars() == 100);
+  encodedAdded = encoded.addAtMostK({1, 2, 3}, 1, MaxSATInstance::PAIRWISE);
+  assert(encodedAdded && encoded.nClauses() == 3);
+
+  // the units of a pseudo-Boolean constraint are undone with its encoding
+  MaxSATInstance pb(100, 0);
+  pb.setMemoryLimit(256);
+  std::vector<uint64_t> coefficients;
+  for(int v = 1; v <= 50; ++ v) coefficients.push_back(v % 2 ? 3 : 2);
+  literals.push_back(51);
+  coefficients.push_back(100);
+  const bool pbAdded = pb.addPB(literals, coefficients, 5);
+  assert(!pbAdded && pb.getErrno() == -ENOMEM);
+  assert(pb.nClauses() == 0 && pb.nVars() == 100);
+
+  // each solver is limited independently, a small limit prevents the backend
+  IncrementalMaxSATSolver small(12, 16), large(12, 16);
+  small.setMemoryLimit(4096);
+  large.setMemoryLimit(1 << 20);
+  const bool smallAdded = addAtMostFiveOfTwelve(small);
+  const bool largeAdded = addAtMostFiveOfTwelve(large);
+  assert(smallAdded && largeAdded);
+
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = small.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::UNKNOWN);
+  assert(small.getErrno() == -ENOMEM && model.empty());
+  ret = large.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(large.getErrno() == 0 && cost == 28);
+
+  // the best known model is returned instead
+  small.setLocalSearch(1000);
+  ret = small.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::SATISFIABLE);
+  assert(small.getErrno() == -ENOMEM && !model.empty() && cost >= 28);
+  uint64_t modelCost = 0;
+  const bool valid = small.getFormula().computeCost(model, modelCost);
+  assert(valid && modelCost == cost);
+}
+
+void pooltest ()
+{
+  cout << "run solver pool test ..." << endl;
+  MaxSATSolverPool pool(4);
+  const size_t prepared = pool.prepare(10, 2);
+  assert(prepared == 2 && pool.idleSolvers() == 2);
+
+  // a returned solver does not remember its previous formula
+  std::unique_ptr<IncrementalMaxSATSolver> solver = pool.acquire(3);
+  assert(solver && pool.idleSolvers() == 1);
+  solver->addClause({1});
+  solver->addClause({-1});
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = solver->compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  pool.release(std::move(solver));
+  solver = pool.acquire(3);
+  bool added = solver->addClause({4});
+  assert(!added && solver->getErrno() == -EINVAL);
+  solver->addClause({1}, 2);
+  ret = solver->compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 0);
+  pool.release(std::move(solver));
+
+  // auxiliary variables do not move a solver to a larger size class, and
+  // its configuration is not passed on
+  solver = pool.acquire(16);
+  const IncrementalMaxSATSolver *pooled = solver.get();
+  {
+    MaxSATSolutionCache cache;
+    solver->setSolutionCache(&cache);
+  }
+  std::vector<int> literals;
+  for(int v = 1; v <= 16; ++ v) literals.push_back(v);
+  added = solver->addAtMostK(literals, 1, MaxSATInstance::LADDER);
+  assert(added && solver->getFormula().nVars() > 16);
+  solver->setMemoryLimit(64);
+  pool.release(std::move(solver));
+  solver = pool.acquire(16);
+  assert(solver.get() == pooled);
+  for(int v = 1; v <= 16; ++ v) {
+    added = solver->addClause({v}, v);
+    assert(added);
+  }
+  ret = solver->compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 0);
+  pool.release(std::move(solver));
+
+  // the instances of amktest_full, solved by several threads sharing the pool
+  std::vector<std::thread> threads;
+  std::atomic<int> failures(0);
+  for(int t = 0; t < 4; ++ t) {
+    threads.push_back(std::thread([&pool, &failures, t]() {
+      for(int total = 2 + t; total < 12; total += 4) {
+        for(int positive = 1; positive + 1 < total; ++ positive) {
+          std::unique_ptr<IncrementalMaxSATSolver> maxsat = pool.acquire(total);
+          vector<int> lits;
+          for(int l = 1; l <= total; ++ l) lits.push_back(l);
+          maxsat->addAtMostK(lits, positive);
+          for(int l = 1; l <= total; ++ l) lits[l - 1] = -l;
+          maxsat->addAtMostK(lits, total - positive);
+          for(int l = 1; l <= total; ++ l) maxsat->addClause({-l}, l);
+          std::vector<int> model;
+          uint64_t cost = 0;
+          if(maxsat->compute_maxsat(model, cost) != MaxSATSolver::ReturnCode::OPTIMAL ||
+             cost != (uint64_t)(positive * (positive + 1)) / 2) failures ++;
+          pool.release(std::move(maxsat));
+        }
+      }
+    }));
+  }
+  for(size_t t = 0; t < threads.size(); ++ t) threads[t].join();
+  cout << "idle solvers: " << pool.idleSolvers() << endl;
+  assert(failures == 0 && pool.idleSolvers() <= 4);
+}
+
+void statisticstest ()
+{
+  cout << "run statistics test ..." << endl;
+  MaxSATInstance formula(6, 0);
+  bool added = formula.addAtMostK({1, 2, 3, 4, 5, 6}, 1, MaxSATInstance::LADDER);
+  added = formula.addAtMostK({1, 2, 3}, 1, MaxSATInstance::LIBRARY) && added;
+  assert(added);
+  const MaxSATInstance::EncodingStatistics &ladder = formula.getEncodingStatistics(MaxSATInstance::LADDER);
+  assert(ladder.constraints == 1 && ladder.variables == 5 && ladder.clauses == formula.nClauses());
+  assert(formula.getEncodingStatistics(MaxSATInstance::LIBRARY).constraints == 1);
+  added = formula.addPB({1, 2, 3}, {3, 2, 2}, 4);
+  assert(added && formula.getPBStatistics().constraints == 1);
+
+  IncrementalMaxSATSolver maxsat(12, 16);
+  maxsat.setStatistics(true);
+  maxsat.setPreprocessing(true);
+  maxsat.setStratification(true);
+  maxsat.setLocalSearch(1000);
+  addAtMostFiveOfTwelve(maxsat);
+
+  std::vector<int> model;
+  uint64_t cost = 0;
+  MaxSATSolver::ReturnCode ret = maxsat.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 28);
+  ret = maxsat.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 28);
+  const IncrementalMaxSATSolver::Statistics &statistics = maxsat.getStatistics();
+  cout << "backend calls: " << statistics.backendCalls << " strata: " << statistics.strata
+       << " backend time: " << statistics.backendTime << " bounds: " << statistics.bounds.size() << endl;
+  assert(statistics.calls == 2 && statistics.reusedOptima == 1);
+  assert(statistics.backendCalls >= 1 && statistics.strata >= 1 && statistics.localSearchRuns >= 1);
+  assert(statistics.backendTime > 0 && statistics.localSearchTime > 0 && statistics.preprocessingTime > 0);
+  assert(!statistics.bounds.empty() && statistics.bounds.back().lowerBound == 28 && statistics.bounds.back().upperBound == 28);
+  assert(statistics.formulaBytes > 0 && statistics.backendBytes > 0);
+
+  // without detailed statistics, only the counters are collected
+  maxsat.resetStatistics();
+  maxsat.setStatistics(false);
+  maxsat.addClause({-1, -2}, 1);
+  ret = maxsat.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 29);
+  assert(maxsat.getStatistics().calls == 1 && maxsat.getStatistics().backendCalls >= 1);
+  assert(maxsat.getStatistics().backendTime == 0 && maxsat.getStatistics().bounds.empty());
+}
+
+void cachetest ()
+{
+  cout << "run solution cache test ..." << endl;
+  MaxSATSolutionCache cache;
+  // the second solver uses the variables in reverse order
+  IncrementalMaxSATSolver first(12, 16), renamed(12, 16), reweighted(12, 16);
+  first.setSolutionCache(&cache);
+  renamed.setSolutionCache(&cache);
+  reweighted.setSolutionCache(&cache);
+  addAtMostFiveOfTwelve(first);
+  addAtMostFiveOfTwelve(renamed, 12, -1);
+  for(int variable = 1; variable <= 12; ++ variable)
+    reweighted.addClause({variable}, 2 * variable);
+  reweighted.addAtMostK({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}, 5);
+
+  std::vector<int> model;
+  uint64_t cost = 0, modelCost = 0;
+  // a call with a bound below the optimum stores nothing
+  MaxSATSolver::ReturnCode ret = first.compute_maxsat(model, cost, 20);
+  assert(ret == MaxSATSolver::ReturnCode::UNKNOWN && model.empty() && cache.size() == 0);
+  ret = first.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 28);
+  assert(cache.getMisses() == 2 && cache.size() == 1);
+  const std::vector<int> firstModel = model;
+
+  // a renamed formula is answered by the cache, without calling the backend
+  ret = renamed.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 28);
+  assert(cache.getHits() == 1 && renamed.getStatistics().backendCalls == 0);
+  bool valid = renamed.getFormula().computeCost(model, modelCost);
+  assert(valid && modelCost == 28);
+
+  // the same hard part results in a start assignment and an upper bound
+  ret = reweighted.compute_maxsat(model, cost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && cost == 56);
+  assert(cache.getNearHits() == 1 && cache.size() == 2);
+  valid = reweighted.getFormula().computeCost(model, modelCost);
+  assert(valid && modelCost == 56);
+
+  // the least recently used model is evicted
+  MaxSATSolutionCache small(cache.memoryUsage() / 2 + 1);
+  MaxSATSolutionCache::Key key;
+  MaxSATSolutionCache::fingerprint(first.getFormula(), key);
+  bool stored = small.store(key, firstModel, 28);
+  assert(stored);
+  MaxSATSolutionCache::fingerprint(reweighted.getFormula(), key);
+  stored = small.store(key, model, 56);
+  assert(stored && small.size() == 1);
+  MaxSATSolutionCache::Match found = small.lookup(reweighted.getFormula(), key, model, cost);
+  assert(found == MaxSATSolutionCache::HIT && cost == 56);
+
+  // a colliding fingerprint of a different formula is not reported as optimal
+  MaxSATSolutionCache::Key collision;
+  MaxSATSolutionCache::fingerprint(first.getFormula(), collision);
+  collision.formula = key.formula;
+  found = small.lookup(first.getFormula(), collision, model, cost);
+  assert(found == MaxSATSolutionCache::NEAR_HIT);
+  valid = first.getFormula().computeCost(model, modelCost);
+  assert(valid && modelCost == cost);
+}
+
+void snapshottest ()
+{
+  cout << "run snapshot test ..." << endl;
+  MaxSATInstance formula(8, 8);
+  formula.addClause({1, 2, 3}, (uint64_t)1 << 40);
+  formula.addClause({-1, -4});
+  formula.addClause({4}, 3);
+  formula.addClause({5, 6}, 2);
+  formula.addAtMostK({3, 4, 5, 6}, 2);
+  formula.addAtMostK({1, 2, 7, 8}, 1, MaxSATInstance::LADDER);
+  for(int variable = 1; variable <= 8; ++ variable) formula.addClause({variable}, variable);
+
+  std::vector<char> buffer;
+  bool stored = formula.serialize(buffer);
+  assert(stored);
+  MaxSATInstance loaded;
+  bool restored = loaded.deserialize(buffer.data(), buffer.size());
+  assert(restored);
+  assert(loaded.nVars() == formula.nVars() && loaded.nClauses() == formula.nClauses());
+  assert(loaded.nAtMostK() == 1 && loaded.atMostKBound(0) == 2 && loaded.atMostKSize(0) == 4);
+  for(size_t i = 0; i < formula.nClauses(); ++ i) {
+    assert(loaded.weight(i) == formula.weight(i) && loaded.clauseSize(i) == formula.clauseSize(i));
+    for(size_t j = 0; j < formula.clauseSize(i); ++ j) assert(loaded.clause(i)[j] == formula.clause(i)[j]);
+  }
+  // weights that need all 64 bits, which the backend does not accept
+  MaxSATInstance wide(1, 1);
+  wide.addClause({1}, UINT64_MAX - 1);
+  std::vector<char> wideBuffer;
+  stored = wide.serialize(wideBuffer);
+  restored = loaded.deserialize(wideBuffer.data(), wideBuffer.size());
+  assert(stored && restored);
+  assert(loaded.nClauses() == 1 && loaded.weight(0) == UINT64_MAX - 1);
+  restored = loaded.deserialize(buffer.data(), buffer.size());
+  assert(restored);
+  const MaxSATInstance::EncodingStatistics &ladder = loaded.getEncodingStatistics(MaxSATInstance::LADDER);
+  assert(ladder.constraints == 1 && ladder.clauses == formula.getEncodingStatistics(MaxSATInstance::LADDER).clauses);
+
+  // store the formula in a file, and solve the loaded formula
+  const char *filename = "/tmp/maxsat-test-snapshot.bin";
+  MaxSATSnapshot snapshot;
+  stored = snapshot.write(formula, filename);
+  assert(stored);
+  MaxSATInstance mapped;
+  restored = snapshot.read(filename, mapped);
+  assert(restored && mapped.nClauses() == formula.nClauses());
+  std::vector<int> model, loadedModel;
+  uint64_t cost = 0, loadedCost = 0;
+  MaxSATSolver solver(formula.nVars(), formula.nClauses()), loadedSolver(mapped.nVars(), mapped.nClauses());
+  const bool solverLoaded = formula.loadInto(solver);
+  const bool mappedLoaded = mapped.loadInto(loadedSolver);
+  assert(solverLoaded && mappedLoaded);
+  MaxSATSolver::ReturnCode ret = solver.compute_maxsat(model, cost);
+  MaxSATSolver::ReturnCode loadedRet = loadedSolver.compute_maxsat(loadedModel, loadedCost);
+  assert(ret == MaxSATSolver::ReturnCode::OPTIMAL && loadedRet == MaxSATSolver::ReturnCode::OPTIMAL);
+  assert(cost == loadedCost);
+  unlink(filename);
+
+  // corrupted data is rejected, and results in an empty formula
+  std::vector<char> corrupted = buffer;
+  corrupted[0] = 'X';
+  restored = loaded.deserialize(corrupted.data(), corrupted.size());
+  assert(!restored && loaded.getErrno() == -EINVAL);
+  assert(loaded.empty());
+  // replace the literal 3 of the first clause by an unknown variable
+  const int firstClause[] = {1, 2, 3, 0}, unknown = 100;
+  corrupted = buffer;
+  for(size_t pos = 0; pos + sizeof(firstClause) <= corrupted.size(); ++ pos) {
+    if(memcmp(&corrupted[pos], firstClause, sizeof(firstClause)) != 0) continue;
+    memcpy(&corrupted[pos + 2 * sizeof(int)], &unknown, sizeof(int));
+    break;
+  }
+  restored = loaded.deserialize(corrupted.data(), corrupted.size());
+  assert(!restored && loaded.getErrno() == -EINVAL);
+  restored = loaded.deserialize(buffer.data(), buffer.size() - 8);
+  assert(!restored && loaded.getErrno() == -EINVAL);
+  restored = snapshot.read("/tmp/maxsat-test-snapshot-missing.bin", loaded);
+  assert(!restored && snapshot.getErrno() == -ENOENT);
+}
+
+void coretest ()
+{
+  cout << "run core extraction test ..." << endl;
+  // 5 pigeons in 4 holes, with a clause per pigeon, and a constraint per hole
+  const int pigeons = 5, holes = 4, distractors = 8;
+  MaxSATCoreExtractor extractor(pigeons * holes + distractors);
+  bool added = true;
+  for(int p = 0; p < pigeons; ++ p) {
+    vector<int> clause;
+    for(int h = 0; h < holes; ++ h) clause.push_back(p * holes + h + 1);
+    added = extractor.addClause(clause, 100 + p) && added;
+  }
+  for(int h = 0; h < holes; ++ h) {
+    vector<int> lits;
+    for(int p = 0; p < pigeons; ++ p) lits.push_back(p * holes + h + 1);
+    added = extractor.addAtMostK(lits, 1, 200 + h) && added;
+  }
+  // constraints that do not contribute to the conflict, where ID 300 forms a group
+  for(int d = 1; d < distractors; ++ d) {
+    added = extractor.addClause({pigeons * holes + d, pigeons * holes + d + 1}, 300 + d % 2) && added;
+    added = extractor.addClause({1, -(pigeons * holes + d)}, 400 + d) && added;
+  }
+  assert(added);
+  added = extractor.addClause({pigeons * holes + distractors + 1}, 500);
+  assert(!added && extractor.getErrno() == -EINVAL);
+
+  std::vector<uint64_t> core;
+  MaxSATSolver::ReturnCode ret = extractor.computeCore(core);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  cout << "core: " << core.size() << " groups with " << extractor.getBackendCalls() << " backend calls" << endl;
+  const std::vector<uint64_t> expected = {100, 101, 102, 103, 104, 200, 201, 202, 203};
+  assert(core == expected);
+
+  // background constraints are not reported, and a satisfiable formula has no core
+  MaxSATCoreExtractor small(3);
+  added = small.addBackgroundClause({-1});
+  added = small.addClause({1, 2}, 7) && added;
+  added = small.addAtMostK({2, 3}, 0, 8) && added;
+  added = small.addClause({-3, 2}, 9) && added;
+  assert(added);
+  ret = small.computeCore(core);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  assert(core.size() == 2 && core[0] == 7 && core[1] == 8);
+  MaxSATCoreExtractor satisfiable(3);
+  added = satisfiable.addBackgroundClause({-1});
+  added = satisfiable.addClause({1, 2}, 7) && added;
+  assert(added);
+  ret = satisfiable.computeCore(core);
+  assert(ret == MaxSATSolver::ReturnCode::SATISFIABLE && core.empty());
+  added = satisfiable.addBackgroundClause({1});
+  assert(added);
+  ret = satisfiable.computeCore(core);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE && core.empty());
+
+  // the hard constraints of a formula are identified by their index
+  MaxSATInstance formula(2, 4);
+  formula.addClause({1}, 3);
+  formula.addClause({1});
+  formula.addClause({-1, 2});
+  formula.addClause({1, 2});
+  formula.addAtMostK({1, 2}, 1);
+  MaxSATCoreExtractor indexed(2);
+  added = indexed.addHardConstraints(formula);
+  assert(added && indexed.nGroups() == 4);
+  ret = indexed.computeCore(core);
+  assert(ret == MaxSATSolver::ReturnCode::UNSATISFIABLE);
+  assert(core.size() == 3 && core[0] == 1 && core[1] == 2 && core[2] == 4);
+}
+
 int main(int argc, char **argv)
 {
   versiontest ();
@@ -501,6 +1683,54 @@ int main(int argc, char **argv)
   cout << endl;
   amktest_limted();
   cout << endl;
+  incrementaltest ();
+  cout << endl;
+  assumptiontest ();
+  cout << endl;
+  portfoliotest ();
+  cout << endl;
+  componenttest ();
+  cout << endl;
+  batchtest ();
+  cout << endl;
+  anytimetest ();
+  cout << endl;
+  timelimittest ();
+  cout << endl;
+  bulktest ();
+  cout << endl;
+  storagetest ();
+  cout << endl;
+  readertest ();
+  cout << endl;
+  pbtest ();
+  cout << endl;
+  encodingtest ();
+  cout << endl;
+  preprocesstest ();
+  cout << endl;
+  stratificationtest ();
+  cout << endl;
+  lexicographictest ();
+  cout << endl;
+  localsearchtest ();
+  cout << endl;
+  warmstarttest ();
+  cout << endl;
+  conflicttest ();
+  cout << endl;
+  memorylimittest ();
+  cout << endl;
+  pooltest ();
+  cout << endl;
+  statisticstest ();
+  cout << endl;
+  cachetest ();
+  cout << endl;
+  snapshottest ();
+  cout << endl;
+  coretest ();
+  cout << endl;
   if(argc==1) {
     nomemtest ();
     cout << endl;
@@ -22,7 +22,7 @@ pushd "$script_dir"
 # run test with statically linked library, if present
 if [ -f ../../lib/libsmax.a ]
 then
-g++ maxsat-test.cc -I../.. -L../../lib -lsmax -std=c++11 -lz -lgmp -o maxsat-test -static --coverage
+g++ maxsat-test.cc -I../.. -L../../lib -lsmax -std=c++11 -pthread -lz -lgmp -o maxsat-test -static --coverage
 ./maxsat-test
 fi
 
@@ -31,9 +31,10 @@ fi
 #  -L../../smax-src      smax-src path to look for libraries
 #  -lsmax                actually link against libsmax.so file
 #  -std=c++11            use c++11 standart, because MaxSATSolver would not compile otherwise
+#  -pthread              support threads, as used by MaxSATPortfolio
 #  -lz                   link against libz library, as required by the SAT solver
 #  -o maxsat-test        name the binary maxsat-test
-g++ maxsat-test.cc -I../.. -L../../lib -lsmax -std=c++11 -lz -lgmp -o maxsat-test --coverage
+g++ maxsat-test.cc -I../.. -L../../lib -lsmax -std=c++11 -pthread -lz -lgmp -o maxsat-test --coverage
 
 # check whether dynamic libraries can be found
 LD_LIBRARY_PATH=../../lib ldd ./maxsat-test